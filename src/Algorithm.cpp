@@ -3,6 +3,10 @@
 //
 
 #include "Algorithm.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
 
 namespace Mandelbrot {
 
@@ -30,4 +34,198 @@ namespace Mandelbrot {
         return mask;
     }
 
+    cv::Mat boundaryIntegral(const cv::Mat &matrix) {
+        CV_Assert(matrix.type() == CV_32FC1);
+        cv::Mat mask(matrix.rows, matrix.cols, CV_8UC1);
+
+#if ENABLE_OPENMP
+#pragma omp parallel for
+#endif
+        for (auto y = 0; y < matrix.rows; ++y) {
+            const auto *row = matrix.ptr<float>(y);
+            const auto *below = y + 1 < matrix.rows ? matrix.ptr<float>(y + 1) : row;
+            auto *out = mask.ptr<uchar>(y);
+            for (auto x = 0; x + 1 < matrix.cols; ++x) {
+                out[x] = row[x] != row[x + 1] || row[x] != below[x];
+            }
+            out[matrix.cols - 1] = row[matrix.cols - 1] != below[matrix.cols - 1];
+        }
+
+        cv::Mat integral;
+        cv::integral(mask, integral, CV_32S);
+        return integral;
+    }
+
+    ZoomTarget findZoomTarget(const cv::Mat &integral, cv::Rect window, int min_size) {
+        CV_Assert(integral.type() == CV_32SC1);
+        auto count = [&integral](const cv::Rect &rect) {
+            const auto x0 = rect.x, x1 = rect.x + rect.width;
+            const auto y0 = rect.y, y1 = rect.y + rect.height;
+            return integral.at<int>(y1, x1) - integral.at<int>(y0, x1) - integral.at<int>(y1, x0) +
+                   integral.at<int>(y0, x0);
+        };
+        const auto window_center = cv::Point2d(window.x + window.width / 2.0, window.y + window.height / 2.0);
+
+        ZoomTarget target;
+        target.path.push_back(window);
+        auto cell = window;
+        while (cell.width >= 2 * min_size && cell.height >= 2 * min_size) {
+            const auto half_w = cell.width / 2, half_h = cell.height / 2;
+            const cv::Rect quadrants[] = {
+                    {cell.x, cell.y, half_w, half_h},
+                    {cell.x + half_w, cell.y, cell.width - half_w, half_h},
+                    {cell.x, cell.y + half_h, half_w, cell.height - half_h},
+                    {cell.x + half_w, cell.y + half_h, cell.width - half_w, cell.height - half_h},
+            };
+
+            auto best = quadrants[0];
+            auto best_count = -1;
+            auto best_distance = 0.0;
+            for (const auto &quadrant: quadrants) {
+                const auto quadrant_count = count(quadrant);
+                const auto dx = quadrant.x + quadrant.width / 2.0 - window_center.x;
+                const auto dy = quadrant.y + quadrant.height / 2.0 - window_center.y;
+                const auto distance = dx * dx + dy * dy;
+                if (quadrant_count > best_count || (quadrant_count == best_count && distance < best_distance)) {
+                    best = quadrant;
+                    best_count = quadrant_count;
+                    best_distance = distance;
+                }
+            }
+
+            // Nothing left to find below this level.
+            if (best_count == 0) {
+                break;
+            }
+            cell = best;
+            target.path.push_back(cell);
+        }
+
+        target.center = cv::Point2d(cell.x + cell.width / 2.0, cell.y + cell.height / 2.0);
+        return target;
+    }
+
+    namespace {
+        // Fixed-point precision of the interpolation weights. Two passes give 2 * ZOOM_INTER_BITS bits in total,
+        // which keeps every intermediate value of an 8-bit image inside uint32_t.
+        constexpr int ZOOM_INTER_BITS = 8;
+        constexpr int ZOOM_INTER_ONE = 1 << ZOOM_INTER_BITS;
+        constexpr uint32_t ZOOM_ROUND = 1u << (2 * ZOOM_INTER_BITS - 1);
+
+        /**
+         * @brief Two neighbouring source indices along one axis and their fixed-point weights.
+         */
+        struct ZoomTap {
+            int index0, index1;
+            int weight0, weight1;
+        };
+
+        ZoomTap makeZoomTap(double coord, int limit) {
+            // Clamp first so that extreme zooms never overflow the integer conversion.
+            coord = std::clamp(coord, -2.0, static_cast<double>(limit) + 1.0);
+            const auto base = static_cast<int>(std::floor(coord));
+            const auto weight1 = static_cast<int>(std::lround((coord - base) * ZOOM_INTER_ONE));
+            ZoomTap tap{base, base + 1, ZOOM_INTER_ONE - weight1, weight1};
+
+            // Taps outside the source read the constant black border, the same as cv::warpAffine does by default.
+            if (tap.index0 < 0 || tap.index0 >= limit) {
+                tap.index0 = 0;
+                tap.weight0 = 0;
+            }
+            if (tap.index1 < 0 || tap.index1 >= limit) {
+                tap.index1 = 0;
+                tap.weight1 = 0;
+            }
+            return tap;
+        }
+
+        template<int CN>
+        void zoomRowHorizontal(const uchar *src, const std::vector<ZoomTap> &taps, uint16_t *out) {
+            for (size_t x = 0; x < taps.size(); ++x) {
+                const auto &tap = taps[x];
+                const uchar *p0 = src + tap.index0 * CN;
+                const uchar *p1 = src + tap.index1 * CN;
+                for (int c = 0; c < CN; ++c) {
+                    out[x * CN + c] = static_cast<uint16_t>(p0[c] * tap.weight0 + p1[c] * tap.weight1);
+                }
+            }
+        }
+
+        template<int CN>
+        void zoomAffineImpl(const cv::Mat &src, cv::Mat &dst, double scale_x, double scale_y, double shift_x,
+                            double shift_y, int row_begin, int row_end) {
+            std::vector<ZoomTap> column_taps(dst.cols);
+            for (int x = 0; x < dst.cols; ++x) {
+                column_taps[x] = makeZoomTap((x - shift_x) / scale_x, src.cols);
+            }
+
+            // When zooming in, neighbouring destination rows share their source rows. Caching the horizontally
+            // resampled rows makes the transform truly separable: each source row is only filtered once.
+            const size_t row_length = static_cast<size_t>(dst.cols) * CN;
+            std::vector<uint16_t> buffer(2 * row_length);
+            uint16_t *rows[2] = {buffer.data(), buffer.data() + row_length};
+            int cached[2] = {-1, -1};
+
+            auto acquire = [&](int source_row, int keep) -> const uint16_t * {
+                for (int slot = 0; slot < 2; ++slot) {
+                    if (cached[slot] == source_row) {
+                        return rows[slot];
+                    }
+                }
+                const int slot = cached[0] == keep ? 1 : 0;
+                zoomRowHorizontal<CN>(src.ptr<uchar>(source_row), column_taps, rows[slot]);
+                cached[slot] = source_row;
+                return rows[slot];
+            };
+
+            for (int y = row_begin; y < row_end; ++y) {
+                const auto tap = makeZoomTap((y - shift_y) / scale_y, src.rows);
+                const uint16_t *row0 = acquire(tap.index0, tap.index1);
+                const uint16_t *row1 = acquire(tap.index1, tap.index0);
+                const auto weight0 = static_cast<uint32_t>(tap.weight0);
+                const auto weight1 = static_cast<uint32_t>(tap.weight1);
+
+                // Contiguous and branch-free, so the compiler vectorizes it.
+                auto *out = dst.ptr<uchar>(y);
+                for (size_t i = 0; i < row_length; ++i) {
+                    out[i] = static_cast<uchar>((row0[i] * weight0 + row1[i] * weight1 + ZOOM_ROUND) >>
+                                                (2 * ZOOM_INTER_BITS));
+                }
+            }
+        }
+    } // namespace
+
+    bool isZoomTransform(const cv::Mat &transform) {
+        CV_Assert(transform.rows == 2 && transform.cols == 3 && transform.type() == CV_64FC1);
+        return transform.at<double>(0, 1) == 0.0 && transform.at<double>(1, 0) == 0.0 &&
+               transform.at<double>(0, 0) > 0.0 && transform.at<double>(1, 1) > 0.0;
+    }
+
+    void zoomAffine(const cv::Mat &src, cv::Mat &dst, const cv::Mat &transform, cv::Size size) {
+        dst.create(size, src.type());
+        zoomAffine(src, dst, transform, 0, size.height);
+    }
+
+    void zoomAffine(const cv::Mat &src, cv::Mat &dst, const cv::Mat &transform, int row_begin, int row_end) {
+        CV_Assert(!dst.empty() && dst.type() == src.type());
+        CV_Assert(0 <= row_begin && row_begin <= row_end && row_end <= dst.rows);
+
+        if (!isZoomTransform(transform) || (src.type() != CV_8UC1 && src.type() != CV_8UC3)) {
+            // Shift the matrix so that the first row of the band lands on row 0.
+            cv::Mat shifted = transform.clone();
+            shifted.at<double>(1, 2) -= row_begin;
+            cv::Mat band = dst.rowRange(row_begin, row_end);
+            cv::warpAffine(src, band, shifted, band.size());
+            return;
+        }
+
+        const auto scale_x = transform.at<double>(0, 0), scale_y = transform.at<double>(1, 1);
+        const auto shift_x = transform.at<double>(0, 2), shift_y = transform.at<double>(1, 2);
+        if (src.channels() == 1) {
+            zoomAffineImpl<1>(src, dst, scale_x, scale_y, shift_x, shift_y, row_begin, row_end);
+        } else {
+            zoomAffineImpl<3>(src, dst, scale_x, scale_y, shift_x, shift_y, row_begin, row_end);
+        }
+    }
+
 } // namespace Mandelbrot
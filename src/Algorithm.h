@@ -11,6 +11,7 @@
 
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
+#include <vector>
 
 namespace Mandelbrot {
 
@@ -21,6 +22,63 @@ namespace Mandelbrot {
      */
     cv::Mat detectHighGradient(const cv::Mat &matrix);
 
+    /**
+     * @brief Build the integral image of the escape time boundary.
+     * @param matrix The raw escape time matrix with CV_32FC1.
+     * @return The integral image with CV_32SC1 and the size of (rows + 1) x (cols + 1).
+     * @note A pixel is on the boundary if its escape time differs from its right or bottom neighbour. The boundary
+     *       count of any rectangle is then four lookups into the integral image.
+     */
+    cv::Mat boundaryIntegral(const cv::Mat &matrix);
+
+    /**
+     * @brief The result of the zoom target search.
+     */
+    struct ZoomTarget {
+        cv::Point2d center; ///< The target in pixel coordinates.
+        std::vector<cv::Rect> path; ///< The visited quadtree cells, from the search window down to the leaf.
+    };
+
+    /**
+     * @brief Search the zoom target with a quadtree over the boundary density.
+     * @param integral The boundary integral image built by boundaryIntegral.
+     * @param window The search window in pixel coordinates.
+     * @param min_size The minimal size of a quadtree cell.
+     * @return The center of the leaf cell and the visited cells.
+     * @note Each level descends into the quadrant with the most boundary pixels. Ties go to the quadrant nearest to
+     *       the center of the window, so that the video does not drift without a reason.
+     */
+    ZoomTarget findZoomTarget(const cv::Mat &integral, cv::Rect window, int min_size);
+
+    /**
+     * @brief Check whether a 2x3 affine matrix only scales and translates.
+     * @param transform The transform matrix with CV_64FC1.
+     * @return True if the matrix has no rotation or shear and a positive scale.
+     */
+    bool isZoomTransform(const cv::Mat &transform);
+
+    /**
+     * @brief Resample the image with a scale-and-translate transform. A drop-in replacement of cv::warpAffine.
+     * @param src The source image.
+     * @param dst The destination image. It will be allocated with the given size and the type of src.
+     * @param transform The forward transform matrix, in the same form as cv::warpAffine expects.
+     * @param size The size of the destination image.
+     * @note The resampler is separable bilinear with precomputed row and column tables. It only handles CV_8UC1 and
+     *       CV_8UC3 images with zoom transforms. Everything else falls back to cv::warpAffine.
+     */
+    void zoomAffine(const cv::Mat &src, cv::Mat &dst, const cv::Mat &transform, cv::Size size);
+
+    /**
+     * @brief Resample the rows [row_begin, row_end) of the destination image.
+     * @param src The source image.
+     * @param dst The destination image. It must be allocated already with the type of src.
+     * @param transform The forward transform matrix, in the same form as cv::warpAffine expects.
+     * @param row_begin The first row to fill.
+     * @param row_end The row after the last one to fill.
+     * @note Different row ranges of the same image can be filled concurrently.
+     */
+    void zoomAffine(const cv::Mat &src, cv::Mat &dst, const cv::Mat &transform, int row_begin, int row_end);
+
 } // namespace Mandelbrot
 
 #endif // MANDELBROTSET_SRC_MANDELBROTSET_ALGORITHM_H
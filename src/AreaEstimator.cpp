@@ -0,0 +1,201 @@
+#include "AreaEstimator.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include "Formula.h"
+#include "PerfCounters.h"
+#include "Utility.h"
+#if ENABLE_OPENMP
+#include <omp.h>
+#endif
+
+namespace Mandelbrot {
+    namespace {
+        constexpr int CELL_COUNT = AreaEstimator::GRID_WIDTH * AreaEstimator::GRID_HEIGHT;
+        constexpr double CELL_WIDTH = (AreaEstimator::SAMPLE_X_MAX - AreaEstimator::SAMPLE_X_MIN) /
+                                      AreaEstimator::GRID_WIDTH;
+        constexpr double CELL_HEIGHT = AreaEstimator::SAMPLE_Y_MAX / AreaEstimator::GRID_HEIGHT;
+    } // namespace
+
+    AreaEstimator::Classification AreaEstimator::classify(double cr, double ci, uint64_t &iterations) const {
+        if (MandelbrotFormula::inMainBulbs(cr, ci)) {
+            return Classification::Interior;
+        }
+
+        // The orbit is compared with the point saved at the last power of two. Once the gap between the two is a
+        // multiple of the period, an attracting cycle brings them together.
+        double zr = 0.0, zi = 0.0, saved_r = 0.0, saved_i = 0.0;
+        size_t next_save = 2;
+        for (size_t n = 1; n <= max_iterations_; ++n) {
+            MandelbrotFormula::step(zr, zi, cr, ci);
+            if (zr * zr + zi * zi > ESCAPE_RADIUS_SQ) {
+                iterations += n;
+                return Classification::Exterior;
+            }
+            if (std::abs(zr - saved_r) < PERIOD_EPSILON && std::abs(zi - saved_i) < PERIOD_EPSILON) {
+                iterations += n;
+                return Classification::Interior;
+            }
+            if (n == next_save) {
+                saved_r = zr;
+                saved_i = zi;
+                next_save *= 2;
+            }
+        }
+        iterations += max_iterations_;
+        return Classification::Undecided;
+    }
+
+    void AreaEstimator::sample(int round, const std::vector<uint32_t> &allocation, std::vector<uint64_t> &hits,
+                               std::vector<uint64_t> &undecided, std::vector<uint64_t> &counts) const {
+        int thread_count = 1;
+#if ENABLE_OPENMP
+        thread_count = thread_count_ > 0 ? thread_count_ : omp_get_max_threads();
+#endif
+
+#if ENABLE_OPENMP
+#pragma omp parallel num_threads(thread_count)
+#endif
+        {
+            Perf::Scope perf_scope("area");
+            std::uniform_real_distribution<double> offset(0.0, 1.0);
+            Stats local;
+
+            // Every cell is drawn by one thread and seeded by its index, so neither the counts nor the samples depend
+            // on the thread count. The boundary cells are far more expensive than the rest, hence the dynamic schedule.
+#if ENABLE_OPENMP
+#pragma omp for schedule(dynamic, 16) nowait
+#endif
+            for (int cell = 0; cell < CELL_COUNT; ++cell) {
+                const auto samples = allocation[cell];
+                if (samples == 0) {
+                    continue;
+                }
+                std::seed_seq seed{static_cast<uint32_t>(seed_), static_cast<uint32_t>(seed_ >> 32),
+                                   static_cast<uint32_t>(round), static_cast<uint32_t>(cell)};
+                std::mt19937_64 rng(seed);
+                const double x0 = SAMPLE_X_MIN + (cell % GRID_WIDTH) * CELL_WIDTH;
+                const double y0 = (cell / GRID_WIDTH) * CELL_HEIGHT;
+
+                uint64_t inside = 0, unsure = 0;
+                for (uint32_t i = 0; i < samples; ++i) {
+                    const double cr = x0 + offset(rng) * CELL_WIDTH;
+                    const double ci = y0 + offset(rng) * CELL_HEIGHT;
+                    switch (classify(cr, ci, local.iterations)) {
+                        case Classification::Undecided:
+                            ++unsure;
+                            [[fallthrough]];
+                        case Classification::Interior:
+                            ++inside;
+                            break;
+                        case Classification::Exterior:
+                            break;
+                    }
+                }
+                hits[cell] += inside;
+                undecided[cell] += unsure;
+                counts[cell] += samples;
+                local.samples += samples;
+                local.interior += inside;
+                local.undecided += unsure;
+            }
+
+#if ENABLE_OPENMP
+#pragma omp critical
+#endif
+            {
+                stats_.samples += local.samples;
+                stats_.interior += local.interior;
+                stats_.undecided += local.undecided;
+                stats_.iterations += local.iterations;
+            }
+        }
+    }
+
+    int AreaEstimator::allocate(size_t samples, const std::vector<uint64_t> &hits, const std::vector<uint64_t> &counts,
+                                std::vector<uint32_t> &allocation) {
+        const auto mixed = [&](int x, int y) {
+            const auto cell = y * GRID_WIDTH + x;
+            return hits[cell] > 0 && hits[cell] < counts[cell];
+        };
+
+        // A cell next to a mixed one may hide a filament that none of its samples hit yet, so it is refined as well.
+        // Its deviation comes from the smoothed fraction, which is never 0 or 1.
+        std::vector<double> weights(CELL_COUNT, 0.0);
+        double total_weight = 0.0;
+        int boundary = 0;
+        for (auto y = 0; y < GRID_HEIGHT; ++y) {
+            for (auto x = 0; x < GRID_WIDTH; ++x) {
+                bool near_boundary = false;
+                for (auto ny = std::max(y - 1, 0); ny <= std::min(y + 1, GRID_HEIGHT - 1) && !near_boundary; ++ny) {
+                    for (auto nx = std::max(x - 1, 0); nx <= std::min(x + 1, GRID_WIDTH - 1); ++nx) {
+                        if (mixed(nx, ny)) {
+                            near_boundary = true;
+                            break;
+                        }
+                    }
+                }
+                if (!near_boundary) {
+                    continue;
+                }
+                const auto cell = y * GRID_WIDTH + x;
+                const double p = (hits[cell] + 0.5) / (counts[cell] + 1.0);
+                weights[cell] = std::sqrt(p * (1.0 - p));
+                total_weight += weights[cell];
+                ++boundary;
+            }
+        }
+
+        for (auto cell = 0; cell < CELL_COUNT; ++cell) {
+            allocation[cell] = total_weight > 0.0
+                                       ? static_cast<uint32_t>(std::ceil(samples * weights[cell] / total_weight))
+                                       : 0;
+        }
+        return boundary;
+    }
+
+    AreaEstimator::Round AreaEstimator::estimate() const {
+        const auto start = std::chrono::steady_clock::now();
+        stats_ = Stats{};
+
+        std::vector<uint64_t> hits(CELL_COUNT, 0), undecided(CELL_COUNT, 0), counts(CELL_COUNT, 0);
+        std::vector<uint32_t> allocation(CELL_COUNT, PILOT_SAMPLES);
+        int boundary = CELL_COUNT;
+        for (int round = 0;; ++round) {
+            sample(round, allocation, hits, undecided, counts);
+
+            // Both halves of the set contribute the same, so the upper half counts twice.
+            double area = 0.0, variance = 0.0, undecided_area = 0.0;
+            for (auto cell = 0; cell < CELL_COUNT; ++cell) {
+                const double p = static_cast<double>(hits[cell]) / counts[cell];
+                area += p;
+                undecided_area += static_cast<double>(undecided[cell]) / counts[cell];
+                if (counts[cell] > 1) {
+                    variance += p * (1.0 - p) / (counts[cell] - 1);
+                }
+            }
+            constexpr double cell_area = 2.0 * CELL_WIDTH * CELL_HEIGHT;
+            stats_.rounds.push_back(Round{
+                    .samples = stats_.samples,
+                    .elapsed = TIME_DIFF(start),
+                    .area = area * cell_area,
+                    .half_width = Z_95 * std::sqrt(variance) * cell_area,
+                    .undecided_area = undecided_area * cell_area,
+                    .boundary_cells = boundary,
+            });
+
+            if (stats_.samples >= sample_count_) {
+                break;
+            }
+            boundary = allocate(std::min(ROUND_SAMPLES, sample_count_ - stats_.samples), hits, counts, allocation);
+            if (boundary == 0) {
+                break;
+            }
+        }
+
+        stats_.wall_time = TIME_DIFF(start);
+        return stats_.rounds.back();
+    }
+
+} // namespace Mandelbrot
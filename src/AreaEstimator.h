@@ -0,0 +1,139 @@
+#ifndef MANDELBROTSET_SRC_AREAESTIMATOR_H
+#define MANDELBROTSET_SRC_AREAESTIMATOR_H
+
+/**
+ * @file AreaEstimator.h
+ * @brief Estimate the area of the Mandelbrot set with a confidence interval.
+ *
+ * The set is symmetric about the real axis, so only the upper half of its bounding box is sampled, on a grid of
+ * cells. Every sample is classified exactly as long as possible: the main cardioid and the period-2 bulb are inside,
+ * an escaping orbit is outside, and an orbit that returns to a point it visited before is periodic and inside. Only
+ * the orbits that do neither within the iteration limit are undecided. They are counted as inside and reported.
+ *
+ * The first round draws the same number of samples in every cell. Every further round spends its samples on the cells
+ * at the boundary, i.e. the cells with mixed results and their neighbors, in proportion to the standard deviation of
+ * the cell. The estimate is the sum of the cell areas weighted by their inside fractions, and its variance is the sum
+ * of the cell variances, since the cells are sampled independently. The undecided samples only bias the estimate
+ * upwards, so their share of the area bounds that bias from one side.
+ */
+
+#include <cstdint>
+#include <vector>
+#include "BaseMandelbrotSet.h"
+
+namespace Mandelbrot {
+
+    class AreaEstimator {
+    public:
+        constexpr static size_t SAMPLE_COUNT = size_t{1} << 24;
+        constexpr static size_t ITERATIONS = size_t{1} << 16;
+        constexpr static int GRID_WIDTH = 256; ///< The cells across SAMPLE_X_MIN to SAMPLE_X_MAX.
+        constexpr static int GRID_HEIGHT = 128; ///< The cells across 0 to SAMPLE_Y_MAX.
+        constexpr static double SAMPLE_X_MIN = -2.0; ///< The set lies in [-2, 0.471] x [-1.123, 1.123].
+        constexpr static double SAMPLE_X_MAX = 0.5;
+        constexpr static double SAMPLE_Y_MAX = 1.25;
+        constexpr static uint32_t PILOT_SAMPLES = 16; ///< The samples of every cell in the first round.
+        constexpr static size_t ROUND_SAMPLES = size_t{1} << 20; ///< The samples of every further round.
+        constexpr static double PERIOD_EPSILON = 1e-13; ///< The distance at which an orbit counts as returned.
+        constexpr static double Z_95 = 1.959963984540054; ///< The two-sided 95% quantile of the normal distribution.
+        constexpr static double REFERENCE_AREA = 1.50659177; ///< The best published estimate, for comparison.
+
+        /**
+         * @brief The estimate after a round of samples.
+         */
+        struct Round {
+            uint64_t samples = 0; ///< The samples up to and including the round.
+            double elapsed = 0; ///< The seconds since the start of the estimate.
+            double area = 0;
+            double half_width = 0; ///< The half width of the 95% confidence interval.
+            double undecided_area = 0; ///< The part of the area from undecided samples, which may be outside.
+            int boundary_cells = 0; ///< The cells the round refined. The first round samples all cells.
+        };
+
+        /**
+         * @brief The work behind an estimate.
+         */
+        struct Stats {
+            uint64_t samples = 0;
+            uint64_t interior = 0; ///< The samples classified as inside, including the undecided ones.
+            uint64_t undecided = 0; ///< The samples that neither escaped nor became periodic.
+            uint64_t iterations = 0;
+            double wall_time = 0;
+            std::vector<Round> rounds;
+        };
+
+        AreaEstimator() = default;
+
+        /**
+         * @brief Set the total samples. The estimate stops after the round that reaches it.
+         */
+        AreaEstimator &setSampleCount(size_t sample_count) {
+            sample_count_ = sample_count;
+            return *this;
+        }
+
+        /**
+         * @brief Set the longest orbit. A longer one that has not become periodic is undecided and counted as inside.
+         */
+        AreaEstimator &setIterations(size_t max_iterations) {
+            max_iterations_ = max_iterations;
+            return *this;
+        }
+
+        /**
+         * @brief Set the seed of the samples. The same seed draws the same samples regardless of the thread count.
+         */
+        AreaEstimator &setSeed(uint64_t seed) {
+            seed_ = seed;
+            return *this;
+        }
+
+        /**
+         * @brief Set the OpenMP threads. Zero uses the OpenMP default.
+         */
+        AreaEstimator &setThreadCount(int thread_count) {
+            thread_count_ = thread_count;
+            return *this;
+        }
+
+        [[nodiscard]] const Stats &getStats() const { return stats_; }
+
+        /**
+         * @brief Sample the set until the sample count is reached.
+         * @return The final estimate. The estimate after every round is in the stats.
+         */
+        Round estimate() const;
+
+    private:
+        enum class Classification { Exterior, Interior, Undecided };
+
+        /**
+         * @brief Classify c with the escape time loop and Brent's cycle detection.
+         * @param iterations Incremented by the iterations spent on c.
+         */
+        [[nodiscard]] Classification classify(double cr, double ci, uint64_t &iterations) const;
+
+        /**
+         * @brief Draw the given samples of every cell in parallel.
+         * @param round The round, which seeds the samples together with the cell.
+         */
+        void sample(int round, const std::vector<uint32_t> &allocation, std::vector<uint64_t> &hits,
+                    std::vector<uint64_t> &undecided, std::vector<uint64_t> &counts) const;
+
+        /**
+         * @brief Spread the samples of a round over the boundary cells by their standard deviations.
+         * @return The boundary cells.
+         */
+        static int allocate(size_t samples, const std::vector<uint64_t> &hits, const std::vector<uint64_t> &counts,
+                            std::vector<uint32_t> &allocation);
+
+        size_t sample_count_{SAMPLE_COUNT};
+        size_t max_iterations_{ITERATIONS};
+        uint64_t seed_{0};
+        int thread_count_{0};
+        mutable Stats stats_;
+    };
+
+} // namespace Mandelbrot
+
+#endif // MANDELBROTSET_SRC_AREAESTIMATOR_H
@@ -9,8 +9,14 @@
  * @file BaseMandelbrotSet.h
  */
 
+#include <chrono>
+#include <ctime>
+#include <optional>
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
+#include "Numa.h"
+#include "RenderStats.h"
+#include "Yuv.h"
 
 namespace Mandelbrot {
     using ColorSchemeType = cv::Vec3b *;
@@ -18,6 +24,25 @@ namespace Mandelbrot {
     constexpr static size_t MAX_ITERATIONS = 1000;
     constexpr static double ESCAPE_RADIUS = 2.0;
     constexpr static double ESCAPE_RADIUS_SQ = ESCAPE_RADIUS * ESCAPE_RADIUS;
+    constexpr static int STREAM_TILE_SIZE = 128;
+
+    template<typename MandelbrotSetImpl>
+    class TileStream;
+
+    /**
+     * @brief The points of the complex plane that the pixels of a render stand for.
+     *
+     * A whole image lays its resolution over its own range. A region keeps the grid of the image it was cut from and
+     * only shifts its pixels, so every pixel of a region is computed from the same numbers as in the whole image.
+     */
+    struct PixelGrid {
+        double x_min, x_max, y_min, y_max;
+        size_t width, height; ///< The resolution of the whole image.
+        int x_offset = 0, y_offset = 0; ///< The first pixel of the region in the whole image.
+
+        [[nodiscard]] double xScale() const { return (x_max - x_min) / width; }
+        [[nodiscard]] double yScale() const { return (y_max - y_min) / height; }
+    };
 
     /**
      * @brief The base class for Mandelbrot set.
@@ -42,26 +67,32 @@ namespace Mandelbrot {
 
         Derived &setWidth(size_t width) {
             static_cast<Derived *>(this)->width_ = width;
+            static_cast<Derived *>(this)->grid_.reset();
             return *static_cast<Derived *>(this);
         }
         Derived &setHeight(size_t height) {
             static_cast<Derived *>(this)->height_ = height;
+            static_cast<Derived *>(this)->grid_.reset();
             return *static_cast<Derived *>(this);
         }
         Derived &setXMin(double x_min) {
             static_cast<Derived *>(this)->x_min_ = x_min;
+            static_cast<Derived *>(this)->grid_.reset();
             return *static_cast<Derived *>(this);
         }
         Derived &setXMax(double x_max) {
             static_cast<Derived *>(this)->x_max_ = x_max;
+            static_cast<Derived *>(this)->grid_.reset();
             return *static_cast<Derived *>(this);
         }
         Derived &setYMin(double y_min) {
             static_cast<Derived *>(this)->y_min_ = y_min;
+            static_cast<Derived *>(this)->grid_.reset();
             return *static_cast<Derived *>(this);
         }
         Derived &setYMax(double y_max) {
             static_cast<Derived *>(this)->y_max_ = y_max;
+            static_cast<Derived *>(this)->grid_.reset();
             return *static_cast<Derived *>(this);
         }
         Derived &setXRange(double x_min, double x_max) { return setXMin(x_min).setXMax(x_max); }
@@ -76,6 +107,7 @@ namespace Mandelbrot {
             self.x_max_ = x_center + xsize / 2;
             self.y_min_ = y_center - ysize / 2;
             self.y_max_ = y_center + ysize / 2;
+            self.grid_.reset();
             return self;
         }
 
@@ -85,6 +117,7 @@ namespace Mandelbrot {
             self.x_max_ = x_center + xsize / 2;
             self.y_min_ = y_center - ysize / 2;
             self.y_max_ = y_center + ysize / 2;
+            self.grid_.reset();
             return self;
         }
 
@@ -93,6 +126,50 @@ namespace Mandelbrot {
             return *static_cast<Derived *>(this);
         }
 
+        /**
+         * @brief Get the pixel grid of the render, see PixelGrid.
+         */
+        [[nodiscard]] PixelGrid getGrid() const {
+            if (grid_) {
+                return *grid_;
+            }
+            return {x_min_, x_max_, y_min_, y_max_, width_, height_};
+        }
+
+        /**
+         * @brief Render on the pixel grid of another view, e.g. to pass a region on to another implementation.
+         * @note Call it after the resolution and range, since setting either of them drops the grid.
+         */
+        Derived &setGrid(const PixelGrid &grid) {
+            static_cast<Derived *>(this)->grid_ = grid;
+            return *static_cast<Derived *>(this);
+        }
+
+        /**
+         * @brief Get a copy that renders a part of the current image.
+         * @param rect The part in the pixel coordinates of the current image.
+         * @return The copy. Its raw matrix is the rect of the raw matrix of the current image, bit for bit.
+         */
+        [[nodiscard]] Derived region(const cv::Rect &rect) const {
+            auto grid = getGrid();
+            const double xscale = grid.xScale(), yscale = grid.yScale();
+            const int x = grid.x_offset + rect.x, y = grid.y_offset + rect.y;
+            auto copy = static_cast<const Derived &>(*this);
+            // The range is the one of the part, for the getters. The pixels are computed on the grid.
+            copy.setResolution(rect.width, rect.height)
+                    .setXRange(grid.x_min + x * xscale, grid.x_min + (x + rect.width) * xscale)
+                    .setYRange(grid.y_min + y * yscale, grid.y_min + (y + rect.height) * yscale);
+            grid.x_offset = x;
+            grid.y_offset = y;
+            return copy.setGrid(grid);
+        }
+
+        /**
+         * @brief Render the image as a stream of tiles on a scheduler. Include TileStream.h to use it.
+         * @param tile_size The edge of the tiles in pixels.
+         */
+        [[nodiscard]] TileStream<Derived> tiles(int tile_size = STREAM_TILE_SIZE) const;
+
         /**
          * @brief Generate the Mandelbrot set image.
          * @return The Mandelbrot set image.
@@ -108,9 +185,15 @@ namespace Mandelbrot {
          */
         [[nodiscard]] cv::Mat colorize(const cv::Mat &matrix) const {
             assert(colors_);
-            cv::Mat image(height_, width_, CV_8UC3);
+            cv::Mat image = Numa::allocate(height_, width_, CV_8UC3);
 
-            for (auto y = 0; y < height_; ++y) {
+            // With pinning, the rows are split like those of the render, so every thread reads and writes its own
+            // node. Otherwise a single thread colorizes, since the caller may already be one of many workers.
+            const auto height = static_cast<int>(height_);
+#if ENABLE_OPENMP
+#pragma omp parallel for schedule(static) if (Numa::pinning())
+#endif
+            for (auto y = 0; y < height; ++y) {
                 for (auto x = 0; x < width_; ++x) {
                     image.at<cv::Vec3b>(y, x) = colors_[static_cast<int>(matrix.template at<float>(y, x))];
                 }
@@ -119,19 +202,92 @@ namespace Mandelbrot {
             return image;
         }
 
+        /**
+         * @brief Colorize the matrix straight into an I420 frame, see Yuv.h.
+         * @param matrix The matrix to colorize. Both sides must be even.
+         * @return The I420 frame.
+         * @note The return type is cv::Mat with CV_8UC1 and 3/2 the rows of the image. Every chroma sample is the
+         *       mean of the 2x2 pixels it covers.
+         */
+        [[nodiscard]] cv::Mat colorizeI420(const cv::Mat &matrix) const {
+            assert(colors_);
+            const auto palette = yuvPalette(std::span<const cv::Vec3b>(colors_, MAX_ITERATIONS + 1));
+            const auto size = i420Size(cv::Size(static_cast<int>(width_), static_cast<int>(height_)));
+            cv::Mat frame = Numa::allocate(size.height, size.width, CV_8UC1);
+            auto [luma, u, v] = i420Planes(frame);
+
+            // The rows are split like those of colorize, one chroma row and its two luma rows at a time.
+            const auto rows = static_cast<int>(height_ / 2), cols = static_cast<int>(width_ / 2);
+#if ENABLE_OPENMP
+#pragma omp parallel for schedule(static) if (Numa::pinning())
+#endif
+            for (auto y = 0; y < rows; ++y) {
+                const float *escape[2] = {matrix.template ptr<float>(2 * y), matrix.template ptr<float>(2 * y + 1)};
+                uchar *luma_rows[2] = {luma.ptr(2 * y), luma.ptr(2 * y + 1)};
+                auto *u_row = u.ptr(y), *v_row = v.ptr(y);
+                for (auto x = 0; x < cols; ++x) {
+                    int u_sum = 0, v_sum = 0;
+                    for (auto dy = 0; dy < 2; ++dy) {
+                        for (auto dx = 0; dx < 2; ++dx) {
+                            const auto &yuv = palette[static_cast<int>(escape[dy][2 * x + dx])];
+                            luma_rows[dy][2 * x + dx] = yuv[0];
+                            u_sum += yuv[1];
+                            v_sum += yuv[2];
+                        }
+                    }
+                    u_row[x] = static_cast<uchar>((u_sum + 2) / 4);
+                    v_row[x] = static_cast<uchar>((v_sum + 2) / 4);
+                }
+            }
+
+            return frame;
+        }
+
         /**
          * @brief Generate the raw matrix.
          * @return The raw escape time matrix.
          * @note The return type is cv::Mat with CV_32FC1.
+         * @note The statistics are kept for getStats, so a view must not be rendered by two threads at once this way.
+         * Concurrent renders of one view use the overload below.
          */
-        [[nodiscard]] cv::Mat generateRawMatrix() const {
-            return static_cast<const Derived *>(this)->generateRawMatrixImpl();
+        [[nodiscard]] cv::Mat generateRawMatrix() const { return generateRawMatrix(stats_); }
+
+        /**
+         * @brief Generate the raw matrix and its statistics.
+         * @param stats Set to the statistics of this render. The view itself is not written.
+         * @return The raw escape time matrix.
+         * @note The CPU time is process wide, so it includes other threads working at the same time.
+         */
+        [[nodiscard]] cv::Mat generateRawMatrix(RenderStats &stats) const {
+            const auto wall_start = std::chrono::steady_clock::now();
+            const auto cpu_start = std::clock();
+
+            // A backend may count the statistics during the render. Otherwise we count them from the matrix.
+            stats = RenderStats();
+            auto matrix = static_cast<const Derived *>(this)->generateRawMatrixImpl(stats);
+            const auto wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+            const auto cpu_time = static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+
+            if (stats.histogram.empty()) {
+                stats = RenderStats::fromRawMatrix(matrix, MAX_ITERATIONS);
+            }
+            stats.wall_time = wall_time;
+            stats.cpu_time = cpu_time;
+            return matrix;
         }
 
+        /**
+         * @brief Get the statistics of the last call to generateRawMatrix without a statistics argument.
+         * @note The CPU time is process wide, so it includes other threads working at the same time.
+         */
+        [[nodiscard]] const RenderStats &getStats() const { return stats_; }
+
     protected:
         size_t width_, height_;
         double x_min_, x_max_, y_min_, y_max_;
         ColorSchemeType colors_;
+        std::optional<PixelGrid> grid_; ///< Set for a region, see PixelGrid.
+        mutable RenderStats stats_; ///< Written by generateRawMatrix(), see there.
     };
 
 } // namespace Mandelbrot
@@ -0,0 +1,60 @@
+#include "BatchRenderer.h"
+#include <filesystem>
+#include <format>
+#include <opencv2/imgcodecs.hpp>
+#include <sstream>
+#include <stdexcept>
+#include "ColorSchemes.h"
+#include "ImageWriter.h"
+
+namespace Mandelbrot {
+
+    std::vector<BatchJob> parseBatchManifest(std::istream &in) {
+        std::vector<BatchJob> jobs;
+        std::string line;
+        for (int line_number = 1; std::getline(in, line); ++line_number) {
+            std::istringstream fields(line);
+            std::string first;
+            if (!(fields >> first) || first.starts_with('#')) {
+                continue;
+            }
+            fields.clear();
+            fields.seekg(0);
+
+            BatchJob job{};
+            std::string scheme;
+            if (!(fields >> job.x_min >> job.x_max >> job.y_min >> job.y_max >> job.width >> job.height >> scheme >>
+                  job.output)) {
+                throw std::runtime_error(std::format("Malformed batch job at line {}", line_number));
+            }
+            if (job.width <= 0 || job.height <= 0 || job.x_min >= job.x_max || job.y_min >= job.y_max) {
+                throw std::runtime_error(std::format("Invalid view at line {}", line_number));
+            }
+            // The schemes are resolved once here. The random ones share a buffer, so a batch uses a single palette.
+            const auto colors = parseColorScheme(scheme);
+            if (!colors) {
+                throw std::runtime_error(std::format("Unknown color scheme {} at line {}", scheme, line_number));
+            }
+            job.colors = *colors;
+            jobs.push_back(std::move(job));
+        }
+        return jobs;
+    }
+
+    bool needsRawOutput(const std::string &path) { return std::filesystem::path(path).extension() == ".pfm"; }
+
+    bool writeBatchOutput(const std::string &path, const cv::Mat &image, const cv::Mat &raw) {
+        const auto extension = std::filesystem::path(path).extension();
+        if (extension == ".qoi") {
+            return writeQOI(path, image);
+        } else if (extension == ".pfm") {
+            return writeRawCounts(path, raw);
+        }
+        try {
+            return cv::imwrite(path, image);
+        } catch (const cv::Exception &) {
+            return false;
+        }
+    }
+
+} // namespace Mandelbrot
@@ -0,0 +1,230 @@
+#ifndef MANDELBROTSET_SRC_BATCHRENDERER_H
+#define MANDELBROTSET_SRC_BATCHRENDERER_H
+
+/**
+ * @file BatchRenderer.h
+ * @brief Render many views in a single process.
+ *
+ * The jobs of a manifest are cut into work units of about PACK_PIXELS pixels. A small job is packed together with its
+ * neighbours into one unit, a large job is split into tiles of TILE_SIZE. The compute workers pull the units from a
+ * shared counter, so the expensive tiles do not hold back the cheap ones. The worker finishing the last tile of a job
+ * colorizes it and hands the image over to the IO pool, so the writes overlap with the rendering of the next jobs.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <exec/async_scope.hpp>
+#include <exec/static_thread_pool.hpp>
+#include <istream>
+#include <opencv2/core.hpp>
+#include <stdexec/execution.hpp>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "MandelbrotSet.h"
+#include "Numa.h"
+#include "PerfCounters.h"
+#include "Trace.h"
+#include "Utility.h"
+
+namespace Mandelbrot {
+
+    /**
+     * @brief A single view of a batch.
+     */
+    struct BatchJob {
+        double x_min, x_max, y_min, y_max;
+        int width, height;
+        ColorSchemeType colors;
+        std::string output;
+    };
+
+    /**
+     * @brief Parse a batch manifest.
+     * @param in The manifest. Every line is a job: <xmin> <xmax> <ymin> <ymax> <width> <height> <scheme> <output>.
+     *           The scheme is a name accepted by parseColorScheme. Empty lines and lines starting with # are skipped.
+     * @return The jobs in the order of the manifest.
+     * @throw std::runtime_error If a line is malformed.
+     */
+    std::vector<BatchJob> parseBatchManifest(std::istream &in);
+
+    /**
+     * @brief Write the result of a job. The format follows the extension of the path.
+     * @param path The output path. .qoi is written with writeQOI, .pfm writes the raw escape counts, everything else
+     *             goes to cv::imwrite.
+     * @param image The colorized image.
+     * @param raw The raw escape time matrix. Only used for .pfm.
+     * @return True if the file is written.
+     */
+    bool writeBatchOutput(const std::string &path, const cv::Mat &image, const cv::Mat &raw);
+
+    /**
+     * @brief Check whether writeBatchOutput needs the raw matrix of a job.
+     */
+    bool needsRawOutput(const std::string &path);
+
+    /**
+     * @brief The batch renderer class.
+     * @tparam MandelbrotSetImpl The Mandelbrot set implementation.
+     */
+    template<typename MandelbrotSetImpl = MandelbrotSet>
+    class BatchRenderer {
+    public:
+        constexpr static int TILE_SIZE = 256;
+        constexpr static int PACK_PIXELS = TILE_SIZE * TILE_SIZE;
+
+        /**
+         * @brief Get the worker count.
+         * @note The worker count is auto detected.
+         */
+        unsigned int getWorkerCount() const { return worker_count_; }
+
+        /**
+         * @brief Get the IO count.
+         * @note The IO count is auto detected.
+         */
+        unsigned int getIOCount() const { return io_count_; }
+
+        /**
+         * @brief Render all jobs and wait for the writes.
+         * @param jobs The jobs.
+         * @return The number of jobs whose output could not be written.
+         */
+        size_t run(const std::vector<BatchJob> &jobs) {
+            const auto start = std::chrono::steady_clock::now();
+            std::vector<JobState> states(jobs.size());
+            for (size_t i = 0; i < jobs.size(); ++i) {
+                const auto &job = jobs[i];
+                states[i].mandelbrot_set.setResolution(job.width, job.height)
+                        .setXRange(job.x_min, job.x_max)
+                        .setYRange(job.y_min, job.y_max)
+                        .setColors(job.colors);
+                states[i].raw.create(job.height, job.width, CV_32FC1);
+            }
+            const auto units = planUnits(jobs, states);
+            println(stdout, "Batch: {} jobs in {} work units on {} workers", jobs.size(), units.size(), worker_count_);
+
+            if (Numa::pinning()) {
+                pinPool(compute_pool_, worker_count_);
+                pinPool(io_pool_, io_count_);
+            }
+
+            failed_ = 0;
+            exec::async_scope scope;
+            std::atomic<size_t> next{0};
+            ex::sync_wait(ex::schedule(compute_pool_.get_scheduler()) | ex::bulk(worker_count_, [&](size_t) {
+                              for (auto i = next.fetch_add(1, std::memory_order_relaxed); i < units.size();
+                                   i = next.fetch_add(1, std::memory_order_relaxed)) {
+                                  for (const auto &[job, rect]: units[i]) {
+                                      renderPart(jobs[job], states[job], static_cast<int>(job), rect, scope);
+                                  }
+                              }
+                          }));
+            ex::sync_wait(scope.on_empty());
+
+            println(stdout, "Batch done in {}s, {} failed", TIME_DIFF(start), failed_.load());
+            return failed_;
+        }
+
+    private:
+        /**
+         * @brief Pin every thread of a pool to its NUMA node.
+         */
+        static void pinPool(exec::static_thread_pool &pool, unsigned int thread_count) {
+            onEveryThread(pool.get_scheduler(), thread_count, [thread_count](size_t i) {
+                Numa::pinCurrentThread(Numa::threadCpus(i, thread_count));
+            });
+        }
+
+        /**
+         * @brief A part of a job in pixel coordinates. A work unit is a list of parts.
+         */
+        using Part = std::pair<size_t, cv::Rect>;
+
+        struct JobState {
+            MandelbrotSetImpl mandelbrot_set{};
+            cv::Mat raw;
+            std::atomic<int> remaining{0};
+        };
+
+        static std::vector<std::vector<Part>> planUnits(const std::vector<BatchJob> &jobs,
+                                                        std::vector<JobState> &states) {
+            std::vector<std::vector<Part>> units;
+            std::vector<Part> pack;
+            int pack_pixels = 0;
+            for (size_t i = 0; i < jobs.size(); ++i) {
+                const auto &job = jobs[i];
+                if (job.width * job.height <= PACK_PIXELS) {
+                    states[i].remaining = 1;
+                    pack.emplace_back(i, cv::Rect(0, 0, job.width, job.height));
+                    pack_pixels += job.width * job.height;
+                    if (pack_pixels >= PACK_PIXELS) {
+                        units.push_back(std::move(pack));
+                        pack = {};
+                        pack_pixels = 0;
+                    }
+                    continue;
+                }
+                for (auto y = 0; y < job.height; y += TILE_SIZE) {
+                    for (auto x = 0; x < job.width; x += TILE_SIZE) {
+                        const auto rect =
+                                cv::Rect(x, y, std::min(TILE_SIZE, job.width - x), std::min(TILE_SIZE, job.height - y));
+                        units.push_back({Part{i, rect}});
+                        ++states[i].remaining;
+                    }
+                }
+            }
+            if (!pack.empty()) {
+                units.push_back(std::move(pack));
+            }
+            return units;
+        }
+
+        void renderPart(const BatchJob &job, JobState &state, int index, const cv::Rect &rect,
+                        exec::async_scope &scope) {
+            {
+                MANDELBROT_TRACE_SCOPE("batchRender", index);
+                Perf::Scope perf_scope("batchRender");
+                // The parallelism is across the parts, so a part renders on the calling worker only.
+                auto part = state.mandelbrot_set.region(rect);
+                if constexpr (requires { part.setThreadCount(1); }) {
+                    part.setThreadCount(1);
+                }
+                cv::Mat target = state.raw(rect);
+                part.generateRawMatrix().copyTo(target);
+            }
+            if (state.remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+                return;
+            }
+
+            // The last part of the job is done.
+            auto image = [&] {
+                MANDELBROT_TRACE_SCOPE("colorize", index);
+                Perf::Scope perf_scope("colorize");
+                return state.mandelbrot_set.colorize(state.raw);
+            }();
+            auto raw = needsRawOutput(job.output) ? state.raw : cv::Mat();
+            state.raw.release();
+            scope.spawn(ex::starts_on(io_pool_.get_scheduler(),
+                                      ex::just() | ex::then([this, &job, index, image = std::move(image),
+                                                             raw = std::move(raw)] {
+                                          MANDELBROT_TRACE_SCOPE("imageWrite", index);
+                                          Perf::Scope perf_scope("imageWrite");
+                                          if (!writeBatchOutput(job.output, image, raw)) {
+                                              println(stderr, "Failed to write image {}", job.output);
+                                              ++failed_;
+                                          }
+                                      })));
+        }
+
+        unsigned int worker_count_{std::max(1u, std::thread::hardware_concurrency())};
+        unsigned int io_count_{std::thread::hardware_concurrency() / 4 + 1};
+        exec::static_thread_pool compute_pool_{worker_count_};
+        exec::static_thread_pool io_pool_{io_count_};
+        std::atomic<size_t> failed_{0};
+    };
+
+} // namespace Mandelbrot
+
+#endif // MANDELBROTSET_SRC_BATCHRENDERER_H
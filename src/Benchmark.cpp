@@ -0,0 +1,252 @@
+/**
+ * @file Benchmark.cpp
+ * @brief The benchmark suite of the hot paths.
+ *
+ * Every benchmark runs on a fixed scene corpus, so the numbers are comparable across commits on the same machine.
+ * The results are written as JSON. Each entry is the median of the repetitions, and renders also report pixels/s,
+ * iterations/s and ns/iteration.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <opencv2/core/utils/logger.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Algorithm.h"
+#include "ColorSchemes.h"
+#include "MandelbrotSet.h"
+#include "MandelbrotSetCuda.h"
+#include "MandelbrotSetSimd.h"
+#include "Utility.h"
+#include "VideoGenerator.h"
+
+namespace {
+    using namespace Mandelbrot;
+
+    /**
+     * @brief A view of the complex plane in the benchmark corpus.
+     */
+    struct Scene {
+        std::string_view name;
+        double x_center, y_center, xsize;
+    };
+
+    // Do not change these without a good reason. Results are only comparable on the same corpus.
+    constexpr Scene SCENES[] = {
+            {"full", -0.5, 0.0, 3.0},
+            {"seahorse", -0.74525, 0.12265, 0.02},
+            {"interior", -0.15, 0.0, 0.4},
+            {"deep", -0.743643887037151, 0.131825904205330, 1e-9},
+    };
+
+    struct Result {
+        std::string name;
+        std::string scene;
+        double seconds;
+        double pixels;
+        double iterations; // Zero if the benchmark does not iterate the formula.
+    };
+
+    struct Options {
+        int width = 1024;
+        int height = 1024;
+        int repeat = 5;
+        bool video = true;
+        std::string output = "MandelbrotBench.json";
+    };
+
+    /**
+     * @brief Time a function and return the median of the repetitions in seconds.
+     * @note Unless disabled, the first call is a warm-up and not measured.
+     */
+    double measure(int repeat, const std::function<void()> &func, bool warm_up = true) {
+        if (warm_up) {
+            func();
+        }
+        std::vector<double> samples;
+        for (int i = 0; i < repeat; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            func();
+            samples.push_back(TIME_DIFF(start));
+        }
+        std::ranges::sort(samples);
+        return samples[samples.size() / 2];
+    }
+
+    template<typename Impl>
+    cv::Mat benchmarkRender(const Options &options, const Scene &scene, std::string_view backend,
+                            std::vector<Result> &results) {
+        Impl mandelbrot_set;
+        mandelbrot_set.setResolution(options.width, options.height)
+                .setCenter(scene.x_center, scene.y_center, scene.xsize);
+
+        cv::Mat raw;
+        const auto seconds = measure(options.repeat, [&] { raw = mandelbrot_set.generateRawMatrix(); });
+        results.push_back({std::format("generateRawMatrix/{}", backend), std::string(scene.name), seconds,
+                           static_cast<double>(options.width) * options.height,
+                           static_cast<double>(mandelbrot_set.getStats().total_iterations)});
+        return raw;
+    }
+
+    void benchmarkStages(const Options &options, const Scene &scene, const cv::Mat &raw,
+                         std::vector<Result> &results) {
+        const double pixels = static_cast<double>(options.width) * options.height;
+        MandelbrotSet mandelbrot_set;
+        mandelbrot_set.setResolution(options.width, options.height).setColors(colorScheme2());
+
+        cv::Mat image;
+        const auto colorize = measure(options.repeat, [&] { image = mandelbrot_set.colorize(raw); });
+        results.push_back({"colorize", std::string(scene.name), colorize, pixels, 0});
+
+        const auto gradient = measure(options.repeat, [&] { [[maybe_unused]] auto _ = detectHighGradient(raw); });
+        results.push_back({"detectHighGradient", std::string(scene.name), gradient, pixels, 0});
+
+        const auto window = cv::Rect(raw.cols * 3 / 7, raw.rows * 3 / 7, raw.cols / 7, raw.rows / 7);
+        const auto target = measure(options.repeat, [&] {
+            [[maybe_unused]] auto _ = findZoomTarget(boundaryIntegral(raw), window, 8);
+        });
+        results.push_back({"findZoomTarget", std::string(scene.name), target, pixels, 0});
+
+        // One keyframe worth of intermediate frames with the default scale rate, toward an off-center target.
+        constexpr int FRAMES = 16;
+        constexpr double SCALE_RATE = 1.03;
+        const auto center = cv::Point2f(options.width * 0.45f, options.height * 0.55f);
+        std::vector<cv::Mat> transforms;
+        for (int i = 0; i < FRAMES; ++i) {
+            transforms.push_back(cv::getRotationMatrix2D(center, 0, std::pow(SCALE_RATE, i)));
+        }
+        cv::Mat frame;
+        const auto size = cv::Size(options.width, options.height);
+        const auto warp = measure(options.repeat, [&] {
+            for (const auto &transform: transforms) {
+                cv::warpAffine(image, frame, transform, size);
+            }
+        });
+        results.push_back({"warpAffine", std::string(scene.name), warp, pixels * FRAMES, 0});
+        const auto zoom = measure(options.repeat, [&] {
+            for (const auto &transform: transforms) {
+                zoomAffine(image, frame, transform, size);
+            }
+        });
+        results.push_back({"zoomAffine", std::string(scene.name), zoom, pixels * FRAMES, 0});
+    }
+
+    void benchmarkVideo(const Options &options, std::vector<Result> &results) {
+        constexpr int MAX_STEP = 4;
+        const auto path = std::filesystem::temp_directory_path() / "MandelbrotBench.y4m";
+        const auto &scene = SCENES[1];
+
+        const auto seconds = measure(1, [&] {
+            VideoGenerator<> generator;
+            generator.setResolution(options.width, options.height)
+                    .setCenter(scene.x_center, scene.y_center)
+                    .setSize(scene.xsize * 16, scene.xsize * 16)
+                    .setMaxStep(MAX_STEP)
+                    .setZoomFactor(2.0)
+                    .setScaleRate(1.03)
+                    .setColors(colorScheme2())
+                    .setWriteKeyframes(false)
+                    .setVideoFormat(VideoFormat::Y4M)
+                    .setVideoName(path.string());
+            generator.start();
+        }, false);
+        std::filesystem::remove(path);
+
+        const double frames = MAX_STEP * std::ceil(std::log(2.0) / std::log(1.03));
+        results.push_back(
+                {"videoPipeline", std::string(scene.name), seconds, frames * options.width * options.height, 0});
+    }
+
+    void writeJson(const Options &options, const std::vector<Result> &results) {
+        std::ofstream out(options.output);
+        out << "{\n";
+        out << std::format("  \"width\": {},\n  \"height\": {},\n  \"repeat\": {},\n", options.width, options.height,
+                           options.repeat);
+        out << std::format("  \"threads\": {},\n", std::thread::hardware_concurrency());
+        out << "  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const auto &result = results[i];
+            out << std::format("    {{\"name\": \"{}\", \"scene\": \"{}\", \"seconds\": {:.6g}, "
+                               "\"pixels_per_second\": {:.6g}",
+                               result.name, result.scene, result.seconds, result.pixels / result.seconds);
+            if (result.iterations > 0) {
+                out << std::format(", \"iterations_per_second\": {:.6g}, \"ns_per_iteration\": {:.6g}",
+                                   result.iterations / result.seconds, result.seconds * 1e9 / result.iterations);
+            }
+            out << (i + 1 < results.size() ? "},\n" : "}\n");
+        }
+        out << "  ]\n}\n";
+    }
+
+    constexpr static auto HELP_MSG = R"(
+Benchmark suite of the Mandelbrot set generator
+
+Usage: MandelbrotBench [options]
+Options:
+    -o / --output <filename>                       Set the JSON output file
+    --resolution <width> <height>                  Set the resolution of the scenes
+    --repeat <n>                                   Set the repetitions of each benchmark
+    --no-video                                     Skip the full video pipeline
+    --help                                         Display this help message
+)";
+
+    Options parseOptions(int argc, char **argv_raw) {
+        Options options;
+        std::vector<std::string> argv(argv_raw, argv_raw + argc);
+        for (size_t i = 1; i < argv.size(); ++i) {
+            if (argv[i] == "--resolution" && i + 2 < argv.size()) {
+                options.width = std::stoi(argv[i + 1]);
+                options.height = std::stoi(argv[i + 2]);
+                i += 2;
+            } else if (argv[i] == "--repeat" && i + 1 < argv.size()) {
+                options.repeat = std::max(1, std::stoi(argv[i + 1]));
+                ++i;
+            } else if ((argv[i] == "-o" || argv[i] == "--output") && i + 1 < argv.size()) {
+                options.output = argv[i + 1];
+                ++i;
+            } else if (argv[i] == "--no-video") {
+                options.video = false;
+            } else {
+                std::cout << HELP_MSG;
+                exit(argv[i] == "--help" ? 0 : 1);
+            }
+        }
+        return options;
+    }
+} // namespace
+
+int main(int argc, char **argv) {
+    cv::utils::logging::setLogLevel(cv::utils::logging::LogLevel::LOG_LEVEL_SILENT);
+    const auto options = parseOptions(argc, argv);
+
+    std::vector<Result> results;
+    for (const auto &scene: SCENES) {
+        println(stdout, "Scene {}", scene.name);
+        const auto raw = benchmarkRender<MandelbrotSet>(options, scene, "cpu", results);
+        benchmarkRender<MandelbrotSetSimd4>(options, scene, "simd4", results);
+        benchmarkRender<MandelbrotSetSimd8>(options, scene, "simd8", results);
+#ifdef ENABLE_CUDA
+        benchmarkRender<MandelbrotSetCuda>(options, scene, "cuda", results);
+#endif
+        benchmarkStages(options, scene, raw, results);
+    }
+    if (options.video) {
+        benchmarkVideo(options, results);
+    }
+
+    for (const auto &result: results) {
+        println(stdout, "{:<28} {:<10} {:>12.6f}s {:>14.4g} px/s", result.name, result.scene, result.seconds,
+                result.pixels / result.seconds);
+    }
+    writeJson(options, results);
+    println(stdout, "Results written to {}", options.output);
+
+    return 0;
+}
@@ -0,0 +1,207 @@
+#include "Buddhabrot.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "MandelbrotSet.h"
+#include "PerfCounters.h"
+#include "Utility.h"
+#if ENABLE_OPENMP
+#include <omp.h>
+#endif
+
+namespace Mandelbrot {
+    cv::Mat Buddhabrot::importanceMap() const {
+        MandelbrotSet coarse(COARSE_SIZE, COARSE_SIZE);
+        coarse.setXRange(-SAMPLE_RANGE, SAMPLE_RANGE)
+                .setYRange(-SAMPLE_RANGE, SAMPLE_RANGE)
+                .setThreadCount(thread_count_);
+        const cv::Mat raw = coarse.generateRawMatrix();
+
+        // A cell is worth the longest escape time around it, since the boundary between two coarse pixels may hide
+        // longer orbits than either of them. Only cells inside the set all around are never sampled.
+        cv::Mat weights(COARSE_SIZE, COARSE_SIZE, CV_64FC1);
+        for (auto y = 0; y < COARSE_SIZE; ++y) {
+            for (auto x = 0; x < COARSE_SIZE; ++x) {
+                float longest = 0.0f, shortest = static_cast<float>(MAX_ITERATIONS);
+                for (auto ny = std::max(y - 1, 0); ny <= std::min(y + 1, COARSE_SIZE - 1); ++ny) {
+                    for (auto nx = std::max(x - 1, 0); nx <= std::min(x + 1, COARSE_SIZE - 1); ++nx) {
+                        longest = std::max(longest, raw.at<float>(ny, nx));
+                        shortest = std::min(shortest, raw.at<float>(ny, nx));
+                    }
+                }
+                const bool interior = shortest >= static_cast<float>(MAX_ITERATIONS);
+                weights.at<double>(y, x) = interior ? 0.0 : longest + 1.0;
+            }
+        }
+        return weights;
+    }
+
+    cv::Mat Buddhabrot::generateDensity() const {
+        const auto start = std::chrono::steady_clock::now();
+        stats_ = Stats{};
+
+        const cv::Mat weights = importanceMap();
+        std::vector<double> cell_weights(weights.ptr<double>(), weights.ptr<double>() + weights.total());
+        double total_weight = 0.0;
+        for (const auto weight: cell_weights) {
+            total_weight += weight;
+        }
+        // A sample from cell k counts 1 / (p_k * cells), so the density is that of uniform sampling.
+        std::vector<float> sample_weights(cell_weights.size());
+        for (size_t k = 0; k < cell_weights.size(); ++k) {
+            sample_weights[k] = cell_weights[k] > 0 ? static_cast<float>(total_weight / (cell_weights[k] *
+                                                                                         cell_weights.size()))
+                                                    : 0.0f;
+        }
+        const std::discrete_distribution<int> cell_distribution(cell_weights.begin(), cell_weights.end());
+
+        const auto width = static_cast<int>(width_), height = static_cast<int>(height_);
+        const double xscale = width_ / (x_max_ - x_min_);
+        const double yscale = height_ / (y_max_ - y_min_);
+        const double cell_size = 2.0 * SAMPLE_RANGE / COARSE_SIZE;
+        const auto chunk_count = static_cast<int64_t>((sample_count_ + CHUNK_SIZE - 1) / CHUNK_SIZE);
+
+        int thread_count = 1;
+#if ENABLE_OPENMP
+        thread_count = thread_count_ > 0 ? thread_count_ : omp_get_max_threads();
+#endif
+        std::vector<cv::Mat> buffers(thread_count);
+
+#if ENABLE_OPENMP
+#pragma omp parallel num_threads(thread_count)
+#endif
+        {
+            Perf::Scope perf_scope("buddhabrot");
+            int thread = 0;
+#if ENABLE_OPENMP
+            thread = omp_get_thread_num();
+#endif
+            // Every thread allocates and touches its own buffer, so it lives in the memory close to the thread.
+            cv::Mat &buffer = buffers[thread];
+            buffer = cv::Mat::zeros(height, width, CV_32FC1);
+            auto cells = cell_distribution;
+            std::uniform_real_distribution<double> offset(0.0, 1.0);
+            Stats local;
+
+            // The chunks are seeded by their index, so the image does not depend on which thread draws a chunk.
+#if ENABLE_OPENMP
+#pragma omp for schedule(dynamic) nowait
+#endif
+            for (int64_t chunk = 0; chunk < chunk_count; ++chunk) {
+                std::seed_seq seed{static_cast<uint32_t>(seed_), static_cast<uint32_t>(seed_ >> 32),
+                                   static_cast<uint32_t>(chunk)};
+                std::mt19937_64 rng(seed);
+                cells.reset();
+                const auto samples = std::min(CHUNK_SIZE, sample_count_ - chunk * CHUNK_SIZE);
+                local.samples += samples;
+
+                for (size_t i = 0; i < samples; ++i) {
+                    const auto cell = cells(rng);
+                    const double cr = -SAMPLE_RANGE + (cell % COARSE_SIZE + offset(rng)) * cell_size;
+                    const double ci = -SAMPLE_RANGE + (cell / COARSE_SIZE + offset(rng)) * cell_size;
+                    if (MandelbrotFormula::inMainBulbs(cr, ci)) {
+                        continue;
+                    }
+
+                    // The first pass only finds the escape time, so nothing is stored per orbit.
+                    double zr = 0.0, zi = 0.0;
+                    size_t steps = 0;
+                    while (steps < max_iterations_ && zr * zr + zi * zi <= ESCAPE_RADIUS_SQ) {
+                        MandelbrotFormula::step(zr, zi, cr, ci);
+                        ++steps;
+                    }
+                    if (zr * zr + zi * zi <= ESCAPE_RADIUS_SQ || steps < min_iterations_) {
+                        continue;
+                    }
+
+                    // The second pass replays the orbit into the density.
+                    ++local.orbits;
+                    const auto weight = sample_weights[cell];
+                    zr = zi = 0.0;
+                    for (size_t step = 0; step < steps; ++step) {
+                        MandelbrotFormula::step(zr, zi, cr, ci);
+                        const double px = (zr - x_min_) * xscale;
+                        const double py = (zi - y_min_) * yscale;
+                        if (px >= 0.0 && px < width && py >= 0.0 && py < height) {
+                            buffer.ptr<float>(static_cast<int>(py))[static_cast<int>(px)] += weight;
+                            ++local.points;
+                        }
+                    }
+                }
+            }
+
+#if ENABLE_OPENMP
+#pragma omp critical
+#endif
+            {
+                stats_.samples += local.samples;
+                stats_.orbits += local.orbits;
+                stats_.points += local.points;
+            }
+        }
+
+        // Sum the buffers row by row. Every row is written by one thread only.
+        cv::Mat density = buffers[0];
+        {
+            Perf::Scope perf_scope("buddhabrotMerge");
+#if ENABLE_OPENMP
+#pragma omp parallel for num_threads(thread_count)
+#endif
+            for (auto y = 0; y < height; ++y) {
+                auto *row = density.ptr<float>(y);
+                for (size_t i = 1; i < buffers.size(); ++i) {
+                    // The runtime may start fewer threads than asked for.
+                    if (buffers[i].empty()) {
+                        continue;
+                    }
+                    const auto *other = buffers[i].ptr<float>(y);
+                    for (auto x = 0; x < width; ++x) {
+                        row[x] += other[x];
+                    }
+                }
+            }
+        }
+
+        stats_.wall_time = TIME_DIFF(start);
+        return density;
+    }
+
+    cv::Mat Buddhabrot::toneMap(const cv::Mat &density) const {
+        CV_Assert(density.type() == CV_32FC1);
+        std::vector<float> values;
+        for (auto y = 0; y < density.rows; ++y) {
+            const auto *row = density.ptr<float>(y);
+            for (auto x = 0; x < density.cols; ++x) {
+                if (row[x] > 0.0f) {
+                    values.push_back(row[x]);
+                }
+            }
+        }
+        float reference = 1.0f;
+        if (!values.empty()) {
+            const auto rank = static_cast<size_t>(TONE_PERCENTILE * (values.size() - 1));
+            std::ranges::nth_element(values, values.begin() + rank);
+            reference = values[rank];
+        }
+
+        cv::Mat image(density.rows, density.cols, CV_8UC3);
+#if ENABLE_OPENMP
+#pragma omp parallel for
+#endif
+        for (auto y = 0; y < density.rows; ++y) {
+            const auto *row = density.ptr<float>(y);
+            for (auto x = 0; x < density.cols; ++x) {
+                const auto level = std::pow(std::min(row[x] / reference, 1.0f), static_cast<float>(TONE_GAMMA));
+                if (colors_) {
+                    image.at<cv::Vec3b>(y, x) = colors_[static_cast<int>(level * (MAX_ITERATIONS - 1))];
+                } else {
+                    const auto gray = static_cast<uchar>(level * 255.0f);
+                    image.at<cv::Vec3b>(y, x) = cv::Vec3b(gray, gray, gray);
+                }
+            }
+        }
+        return image;
+    }
+
+} // namespace Mandelbrot
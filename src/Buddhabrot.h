@@ -0,0 +1,151 @@
+#ifndef MANDELBROTSET_SRC_BUDDHABROT_H
+#define MANDELBROTSET_SRC_BUDDHABROT_H
+
+/**
+ * @file Buddhabrot.h
+ * @brief Render the orbit density of the escaping points, also known as the Buddhabrot.
+ *
+ * Instead of coloring c by its escape time, many c are sampled and every z visited by an escaping orbit is counted
+ * in the pixel it falls into. The orbits land anywhere in the image, so every thread counts into its own density
+ * buffer, and the buffers are summed row by row at the end. No pixel is ever shared between threads during the
+ * sampling, which keeps the sampling linear in the number of cores.
+ *
+ * The samples are drawn from a coarse escape time pass, in proportion to the longest escape time around each cell.
+ * Long orbits start close to the boundary, so most samples go where the image is made. Every sample is weighted by
+ * the inverse of its probability, so the density matches that of uniform sampling.
+ */
+
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include "BaseMandelbrotSet.h"
+
+namespace Mandelbrot {
+
+    class Buddhabrot {
+    public:
+        constexpr static size_t SAMPLE_COUNT = size_t{1} << 24;
+        constexpr static size_t MIN_ITERATIONS = 20; ///< Shorter orbits only add a haze around the set.
+        constexpr static int COARSE_SIZE = 256; ///< The resolution of the importance map over SAMPLE_RANGE.
+        constexpr static double SAMPLE_RANGE = ESCAPE_RADIUS; ///< Every c outside the square escapes at once.
+        constexpr static size_t CHUNK_SIZE = size_t{1} << 16; ///< The samples of a chunk share one random stream.
+        constexpr static double TONE_GAMMA = 0.5;
+        constexpr static double TONE_PERCENTILE = 0.999; ///< The density mapped to full brightness.
+
+        /**
+         * @brief The work behind a density image.
+         */
+        struct Stats {
+            uint64_t samples = 0;
+            uint64_t orbits = 0; ///< The samples that escaped after at least min_iterations.
+            uint64_t points = 0; ///< The orbit points that fell into the image.
+            double wall_time = 0;
+        };
+
+        Buddhabrot() = default;
+        Buddhabrot(const size_t width, const size_t height) : width_(width), height_(height) {}
+
+        Buddhabrot &setResolution(size_t width, size_t height) {
+            width_ = width;
+            height_ = height;
+            return *this;
+        }
+
+        Buddhabrot &setXRange(double x_min, double x_max) {
+            x_min_ = x_min;
+            x_max_ = x_max;
+            return *this;
+        }
+
+        Buddhabrot &setYRange(double y_min, double y_max) {
+            y_min_ = y_min;
+            y_max_ = y_max;
+            return *this;
+        }
+
+        Buddhabrot &setSampleCount(size_t sample_count) {
+            sample_count_ = sample_count;
+            return *this;
+        }
+
+        /**
+         * @brief Set the escape times of the orbits that are counted.
+         * @param min_iterations The shortest counted orbit.
+         * @param max_iterations The longest orbit. A longer one is taken as the interior and not counted.
+         */
+        Buddhabrot &setIterations(size_t min_iterations, size_t max_iterations) {
+            min_iterations_ = min_iterations;
+            max_iterations_ = max_iterations;
+            return *this;
+        }
+
+        /**
+         * @brief Set the seed of the samples. The same seed draws the same samples regardless of the thread count.
+         */
+        Buddhabrot &setSeed(uint64_t seed) {
+            seed_ = seed;
+            return *this;
+        }
+
+        /**
+         * @brief Set the OpenMP threads. Zero uses the OpenMP default.
+         * @note Every thread holds a float density buffer of the image size.
+         */
+        Buddhabrot &setThreadCount(int thread_count) {
+            thread_count_ = thread_count;
+            return *this;
+        }
+
+        /**
+         * @brief Set the colors of the tone-mapped image. Without colors, the image is grayscale.
+         */
+        Buddhabrot &setColors(ColorSchemeType colors) {
+            colors_ = colors;
+            return *this;
+        }
+
+        [[nodiscard]] size_t getWidth() const { return width_; }
+        [[nodiscard]] size_t getHeight() const { return height_; }
+        [[nodiscard]] const Stats &getStats() const { return stats_; }
+
+        /**
+         * @brief Sample the orbits.
+         * @return The orbit density with CV_32FC1, in expected hits per pixel for the sample count.
+         */
+        [[nodiscard]] cv::Mat generateDensity() const;
+
+        /**
+         * @brief Sample the orbits and tone-map the density.
+         * @return The image with CV_8UC3.
+         */
+        [[nodiscard]] cv::Mat generate() const { return toneMap(generateDensity()); }
+
+        /**
+         * @brief Map a density to an image.
+         * @param density The density with CV_32FC1.
+         * @return The image with CV_8UC3.
+         * @note The density is scaled so that its TONE_PERCENTILE of the non-empty pixels is full brightness, then
+         *       compressed with TONE_GAMMA. A few very bright pixels, e.g. around the fixed points, do not darken the
+         *       rest of the image.
+         */
+        [[nodiscard]] cv::Mat toneMap(const cv::Mat &density) const;
+
+    private:
+        /**
+         * @brief Build the importance map from a coarse escape time pass.
+         * @return The sampling weight of every cell with CV_64FC1.
+         */
+        [[nodiscard]] cv::Mat importanceMap() const;
+
+        size_t width_{0}, height_{0};
+        double x_min_{-2.0}, x_max_{2.0}, y_min_{-2.0}, y_max_{2.0};
+        size_t sample_count_{SAMPLE_COUNT};
+        size_t min_iterations_{MIN_ITERATIONS}, max_iterations_{MAX_ITERATIONS};
+        uint64_t seed_{0};
+        int thread_count_{0};
+        ColorSchemeType colors_{nullptr};
+        mutable Stats stats_;
+    };
+
+} // namespace Mandelbrot
+
+#endif // MANDELBROTSET_SRC_BUDDHABROT_H
@@ -57,7 +57,11 @@ namespace Mandelbrot {
 
     ColorSchemeType randomScheme() {
         static std::random_device rd;
-        static std::mt19937 rng(rd());
+        return randomScheme(rd());
+    }
+
+    ColorSchemeType randomScheme(uint32_t seed) {
+        std::mt19937 rng(seed);
         static cv::Vec3b colors[MAX_ITERATIONS + 1];
         std::uniform_real_distribution<double> mean_dist(64, 192);
         std::normal_distribution<double> dist(0, 1.0);
@@ -97,4 +101,17 @@ namespace Mandelbrot {
         return colors;
     }
 
+    std::optional<ColorSchemeType> parseColorScheme(std::string_view name) {
+        if (name == "1") {
+            return colorScheme1();
+        } else if (name == "2") {
+            return colorScheme2();
+        } else if (name == "random") {
+            return randomScheme();
+        } else if (name == "normal") {
+            return normalDistScheme();
+        }
+        return std::nullopt;
+    }
+
 } // namespace Mandelbrot
@@ -9,6 +9,8 @@
  * @file ColorSchemes.h
  */
 
+#include <optional>
+#include <string_view>
 #include "BaseMandelbrotSet.h"
 
 namespace Mandelbrot {
@@ -32,6 +34,14 @@ namespace Mandelbrot {
      */
     ColorSchemeType randomScheme();
 
+    /**
+     * @brief Random color scheme from a seed.
+     * @param seed The seed. The same seed gives the same scheme.
+     * @return A pointer to the color scheme array.
+     * @note The schemes are generated on every call into the same buffer as randomScheme().
+     */
+    ColorSchemeType randomScheme(uint32_t seed);
+
     /**
      * @brief Normal distribution color scheme.
      * @return A pointer to the color scheme array.
@@ -39,6 +49,14 @@ namespace Mandelbrot {
      */
     ColorSchemeType normalDistScheme();
 
+    /**
+     * @brief Get a color scheme by name.
+     * @param name One of "1", "2", "random" and "normal".
+     * @return The color scheme, or std::nullopt if the name is unknown.
+     * @note The random schemes are generated on every call into the same buffer.
+     */
+    std::optional<ColorSchemeType> parseColorScheme(std::string_view name);
+
 } // namespace Mandelbrot
 
 #endif // MANDELBROTSET_SRC_MANDELBROTSET_COLORSCHEMES_H
@@ -0,0 +1,174 @@
+#ifndef MANDELBROTSET_SRC_FORMULA_H
+#define MANDELBROTSET_SRC_FORMULA_H
+
+/**
+ * @file Formula.h
+ * @brief The iteration formulas of the escape time fractals.
+ *
+ * A formula is a policy of BasicMandelbrotSet. It maps a pixel to the start point z0 and the constant c, and advances
+ * z by one iteration. The step is a template on the number type, so the same policy serves the scalar loop and a
+ * lane-batched one, and is resolved at compile time, so the default Mandelbrot loop is the same code as before.
+ */
+
+#include <cmath>
+#include <optional>
+#include <string_view>
+
+namespace Mandelbrot {
+
+    /**
+     * @brief z = z^2 + c with z0 = 0 and c the pixel.
+     */
+    struct MandelbrotFormula {
+        constexpr static std::string_view NAME = "mandelbrot";
+
+        template<typename T>
+        void start(T x, T y, T &zr, T &zi, T &cr, T &ci) const {
+            zr = zi = T(0);
+            cr = x;
+            ci = y;
+        }
+
+        template<typename T>
+        static void step(T &zr, T &zi, T cr, T ci) {
+            const T r = zr * zr - zi * zi + cr;
+            zi = T(2) * zr * zi + ci;
+            zr = r;
+        }
+
+        /**
+         * @brief Whether c lies in the main cardioid or the period-2 bulb. Such orbits never escape, and they are the
+         *        most expensive ones to reject.
+         */
+        static bool inMainBulbs(double x, double y) {
+            const double xq = x - 0.25;
+            const double q = xq * xq + y * y;
+            return q * (q + xq) <= 0.25 * y * y || (x + 1.0) * (x + 1.0) + y * y <= 0.0625;
+        }
+    };
+
+    /**
+     * @brief z = z^2 + c with z0 the pixel and a fixed c.
+     */
+    struct JuliaFormula {
+        constexpr static std::string_view NAME = "julia";
+
+        double c_real = -0.8, c_imag = 0.156;
+
+        template<typename T>
+        void start(T x, T y, T &zr, T &zi, T &cr, T &ci) const {
+            zr = x;
+            zi = y;
+            cr = T(c_real);
+            ci = T(c_imag);
+        }
+
+        template<typename T>
+        static void step(T &zr, T &zi, T cr, T ci) {
+            MandelbrotFormula::step(zr, zi, cr, ci);
+        }
+    };
+
+    /**
+     * @brief z = z^D + c with z0 = 0 and c the pixel.
+     * @tparam D The integer power, at least 2.
+     */
+    template<int D>
+    struct MultibrotFormula {
+        static_assert(D >= 2, "The power of a Multibrot set is at least 2");
+        constexpr static std::string_view NAME = "multibrot";
+
+        template<typename T>
+        void start(T x, T y, T &zr, T &zi, T &cr, T &ci) const {
+            MandelbrotFormula{}.start(x, y, zr, zi, cr, ci);
+        }
+
+        template<typename T>
+        static void step(T &zr, T &zi, T cr, T ci) {
+            T pr, pi;
+            power<D>(zr, zi, pr, pi);
+            zr = pr + cr;
+            zi = pi + ci;
+        }
+
+    private:
+        /**
+         * @brief (rr, ri) = (zr + i zi)^N by squaring. The recursion is resolved at compile time, so z^3 is two
+         *        multiplications and z^4 is two squarings.
+         */
+        template<int N, typename T>
+        static void power(T zr, T zi, T &rr, T &ri) {
+            if constexpr (N == 1) {
+                rr = zr;
+                ri = zi;
+            } else {
+                T hr, hi;
+                power<N / 2>(zr, zi, hr, hi);
+                rr = hr * hr - hi * hi;
+                ri = T(2) * hr * hi;
+                if constexpr (N % 2 == 1) {
+                    const T r = rr * zr - ri * zi;
+                    ri = rr * zi + ri * zr;
+                    rr = r;
+                }
+            }
+        }
+    };
+
+    /**
+     * @brief z = (|Re z| + i |Im z|)^2 + c with z0 = 0 and c the pixel.
+     */
+    struct BurningShipFormula {
+        constexpr static std::string_view NAME = "burning-ship";
+
+        template<typename T>
+        void start(T x, T y, T &zr, T &zi, T &cr, T &ci) const {
+            MandelbrotFormula{}.start(x, y, zr, zi, cr, ci);
+        }
+
+        template<typename T>
+        static void step(T &zr, T &zi, T cr, T ci) {
+            using std::abs;
+            const T ar = abs(zr), ai = abs(zi);
+            zr = ar * ar - ai * ai + cr;
+            zi = T(2) * ar * ai + ci;
+        }
+    };
+
+    /**
+     * @brief The formulas selectable at runtime.
+     */
+    enum class FormulaKind {
+        Mandelbrot,
+        Julia,
+        BurningShip,
+        Multibrot3,
+        Multibrot4,
+        Multibrot5,
+    };
+
+    /**
+     * @brief Parse the name of a formula.
+     * @param name One of "mandelbrot", "julia", "burning-ship", "multibrot3", "multibrot4" and "multibrot5".
+     * @return The formula, or std::nullopt if the name is unknown.
+     */
+    inline std::optional<FormulaKind> parseFormulaKind(std::string_view name) {
+        if (name == "mandelbrot") {
+            return FormulaKind::Mandelbrot;
+        } else if (name == "julia") {
+            return FormulaKind::Julia;
+        } else if (name == "burning-ship") {
+            return FormulaKind::BurningShip;
+        } else if (name == "multibrot3") {
+            return FormulaKind::Multibrot3;
+        } else if (name == "multibrot4") {
+            return FormulaKind::Multibrot4;
+        } else if (name == "multibrot5") {
+            return FormulaKind::Multibrot5;
+        }
+        return std::nullopt;
+    }
+
+} // namespace Mandelbrot
+
+#endif // MANDELBROTSET_SRC_FORMULA_H
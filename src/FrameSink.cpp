@@ -0,0 +1,153 @@
+#include "FrameSink.h"
+#include <cmath>
+#include <format>
+#include <fstream>
+#include <limits>
+#include <opencv2/imgproc.hpp>
+#include <stdexcept>
+#include "Yuv.h"
+
+namespace Mandelbrot {
+
+    std::optional<VideoFormat> parseVideoFormat(std::string_view name) {
+        if (name == "encoded") {
+            return VideoFormat::Encoded;
+        } else if (name == "y4m") {
+            return VideoFormat::Y4M;
+        } else if (name == "raw") {
+            return VideoFormat::RawBGR;
+        }
+        return std::nullopt;
+    }
+
+    EncodedFrameSink::EncodedFrameSink(const std::string &path, cv::Size size, double fps) {
+        writer_.open(path, cv::VideoWriter::fourcc('h', 'v', 'c', 'l'), fps, size, true);
+    }
+
+    EncodedFrameSink::~EncodedFrameSink() { writer_.release(); }
+
+    void EncodedFrameSink::write(const cv::Mat &frame) {
+        if (frame.type() == CV_8UC1) {
+            cv::cvtColor(frame, bgr_, cv::COLOR_YUV2BGR_I420);
+            writer_.write(bgr_);
+            return;
+        }
+        writer_.write(frame);
+    }
+
+    RawFrameSink::RawFrameSink(const std::string &path, cv::Size size, double fps, bool y4m) : size_(size), y4m_(y4m) {
+        file_ = std::fopen(path.c_str(), "wb");
+        if (!file_) {
+            throw std::runtime_error(std::format("Cannot open {} for the video stream", path));
+        }
+        // Every write is already a whole plane or frame, so a stdio buffer would only add a copy.
+        std::setvbuf(file_, nullptr, _IONBF, 0);
+
+        if (y4m_) {
+            if (size.width % 2 != 0 || size.height % 2 != 0) {
+                throw std::runtime_error("Y4M output with 4:2:0 chroma requires an even resolution");
+            }
+            // The frame rate is a ratio in Y4M. Millisecond precision covers the fractional NTSC rates.
+            const auto rate = static_cast<long long>(std::llround(fps * 1000));
+            const auto header = std::format("YUV4MPEG2 W{} H{} F{}:1000 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n",
+                                            size.width, size.height, rate);
+            writeBytes(header.data(), header.size());
+        }
+    }
+
+    RawFrameSink::~RawFrameSink() {
+        if (file_) {
+            std::fclose(file_);
+        }
+    }
+
+    void RawFrameSink::write(const cv::Mat &frame) {
+        const auto i420 = isI420(frame, size_);
+        CV_Assert(i420 || (frame.type() == CV_8UC3 && frame.size() == size_));
+        if (!y4m_) {
+            if (i420) {
+                cv::cvtColor(frame, converted_, cv::COLOR_YUV2BGR_I420);
+                writeMat(converted_);
+            } else {
+                writeMat(frame);
+            }
+            return;
+        }
+
+        constexpr static char FRAME_HEADER[] = "FRAME\n";
+        writeBytes(FRAME_HEADER, sizeof(FRAME_HEADER) - 1);
+        if (i420) {
+            writeMat(frame);
+            return;
+        }
+        cv::cvtColor(frame, converted_, cv::COLOR_BGR2YUV_I420);
+        writeMat(converted_);
+    }
+
+    void RawFrameSink::writeBytes(const void *data, size_t size) {
+        if (std::fwrite(data, 1, size, file_) != size) {
+            throw std::runtime_error("Failed to write the video stream");
+        }
+    }
+
+    void RawFrameSink::writeMat(const cv::Mat &mat) {
+        const auto row_bytes = mat.cols * mat.elemSize();
+        if (mat.isContinuous()) {
+            writeBytes(mat.data, row_bytes * mat.rows);
+            return;
+        }
+        for (auto y = 0; y < mat.rows; ++y) {
+            writeBytes(mat.ptr<uchar>(y), row_bytes);
+        }
+    }
+
+    std::unique_ptr<FrameSink> makeFrameSink(VideoFormat format, const std::string &path, cv::Size size, double fps) {
+        switch (format) {
+            case VideoFormat::Y4M:
+                return std::make_unique<RawFrameSink>(path, size, fps, true);
+            case VideoFormat::RawBGR:
+                return std::make_unique<RawFrameSink>(path, size, fps, false);
+            case VideoFormat::Encoded:
+            default:
+                return std::make_unique<EncodedFrameSink>(path, size, fps);
+        }
+    }
+
+    bool concatenateVideos(VideoFormat format, std::span<const std::filesystem::path> segments, const std::string &path,
+                           cv::Size size, double fps) {
+        bool complete = true;
+        if (format == VideoFormat::Encoded) {
+            EncodedFrameSink sink(path, size, fps);
+            cv::Mat frame;
+            for (const auto &segment: segments) {
+                cv::VideoCapture capture(segment.string());
+                complete &= capture.isOpened();
+                while (capture.read(frame)) {
+                    sink.write(frame);
+                }
+            }
+            return complete;
+        }
+
+        std::ofstream output(path, std::ios::binary | std::ios::trunc);
+        if (!output) {
+            throw std::runtime_error(std::format("Cannot open {} for the video stream", path));
+        }
+        for (size_t i = 0; i < segments.size(); ++i) {
+            std::ifstream input(segments[i], std::ios::binary);
+            if (!input) {
+                complete = false;
+                continue;
+            }
+            if (format == VideoFormat::Y4M && i > 0) {
+                input.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            }
+            output << input.rdbuf();
+        }
+        if (!output.flush()) {
+            throw std::runtime_error("Failed to write the video stream");
+        }
+        return complete;
+    }
+
+} // namespace Mandelbrot
@@ -0,0 +1,121 @@
+#ifndef MANDELBROTSET_SRC_FRAMESINK_H
+#define MANDELBROTSET_SRC_FRAMESINK_H
+
+/**
+ * @file FrameSink.h
+ * @brief The output sinks for video frames.
+ */
+
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace Mandelbrot {
+
+    /**
+     * @brief The format of the video output.
+     */
+    enum class VideoFormat {
+        Encoded, ///< Encoded in process by cv::VideoWriter.
+        Y4M, ///< YUV4MPEG2 stream with 4:2:0 chroma, readable by ffmpeg and most encoders.
+        RawBGR, ///< Headerless packed BGR frames.
+    };
+
+    /**
+     * @brief Parse the video format from its command line name.
+     * @param name One of "encoded", "y4m" and "raw".
+     * @return The video format, or std::nullopt if the name is unknown.
+     */
+    std::optional<VideoFormat> parseVideoFormat(std::string_view name);
+
+    /**
+     * @brief The destination of the video frames.
+     * @note Frames must be written in order and from one thread at a time.
+     */
+    class FrameSink {
+    public:
+        virtual ~FrameSink() = default;
+
+        /**
+         * @brief Write a frame.
+         * @param frame The frame with CV_8UC3 in BGR order, or its I420 frame with CV_8UC1, see Yuv.h.
+         */
+        virtual void write(const cv::Mat &frame) = 0;
+    };
+
+    /**
+     * @brief The sink encoding frames in process with cv::VideoWriter.
+     */
+    class EncodedFrameSink final : public FrameSink {
+    public:
+        EncodedFrameSink(const std::string &path, cv::Size size, double fps);
+        ~EncodedFrameSink() override;
+
+        void write(const cv::Mat &frame) override;
+
+    private:
+        cv::VideoWriter writer_;
+        cv::Mat bgr_;
+    };
+
+    /**
+     * @brief The sink streaming uncompressed frames to a file, a named pipe or a /dev/fd/N path.
+     * @note The stream is unbuffered, so continuous frames go from their buffer to the file descriptor without any
+     *       intermediate copy. I420 frames go to Y4M as they are, only a conversion between BGR and YUV needs a
+     *       buffer, which is reused between frames.
+     */
+    class RawFrameSink final : public FrameSink {
+    public:
+        RawFrameSink(const std::string &path, cv::Size size, double fps, bool y4m);
+        ~RawFrameSink() override;
+
+        RawFrameSink(const RawFrameSink &) = delete;
+        RawFrameSink &operator=(const RawFrameSink &) = delete;
+
+        void write(const cv::Mat &frame) override;
+
+    private:
+        void writeBytes(const void *data, size_t size);
+        void writeMat(const cv::Mat &mat);
+
+        std::FILE *file_{nullptr};
+        cv::Size size_;
+        bool y4m_;
+        cv::Mat converted_;
+    };
+
+    /**
+     * @brief Create the sink for the given format.
+     * @param format The video format.
+     * @param path The output path.
+     * @param size The frame size.
+     * @param fps The frame rate.
+     * @return The sink.
+     * @throw std::runtime_error if the output cannot be opened.
+     */
+    std::unique_ptr<FrameSink> makeFrameSink(VideoFormat format, const std::string &path, cv::Size size, double fps);
+
+    /**
+     * @brief Concatenate videos written by the sinks of one format into one video.
+     * @param format The video format of the segments and of the output.
+     * @param segments The segments in order.
+     * @param path The output path.
+     * @param size The frame size.
+     * @param fps The frame rate.
+     * @return Whether every segment was read.
+     * @note Y4M and raw streams are copied as they are, only the stream header of every Y4M segment but the first is
+     *       dropped. Encoded segments are decoded and encoded again, since cv::VideoWriter cannot copy the packets.
+     * @throw std::runtime_error if the output cannot be written.
+     */
+    bool concatenateVideos(VideoFormat format, std::span<const std::filesystem::path> segments, const std::string &path,
+                           cv::Size size, double fps);
+
+} // namespace Mandelbrot
+
+#endif // MANDELBROTSET_SRC_FRAMESINK_H
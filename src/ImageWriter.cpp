@@ -0,0 +1,158 @@
+#include "ImageWriter.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <format>
+#include <memory>
+#include <opencv2/imgcodecs.hpp>
+#include <vector>
+
+namespace Mandelbrot {
+
+    namespace {
+        bool writeFile(const std::string &path, const void *data, size_t size) {
+            std::unique_ptr<std::FILE, decltype(&std::fclose)> file(std::fopen(path.c_str(), "wb"), &std::fclose);
+            if (!file) {
+                return false;
+            }
+            return std::fwrite(data, 1, size, file.get()) == size;
+        }
+
+        // See https://qoiformat.org/qoi-specification.pdf
+        constexpr uint8_t QOI_OP_INDEX = 0x00;
+        constexpr uint8_t QOI_OP_DIFF = 0x40;
+        constexpr uint8_t QOI_OP_LUMA = 0x80;
+        constexpr uint8_t QOI_OP_RUN = 0xc0;
+        constexpr uint8_t QOI_OP_RGB = 0xfe;
+        constexpr int QOI_MAX_RUN = 62;
+        constexpr std::array<uint8_t, 8> QOI_PADDING = {0, 0, 0, 0, 0, 0, 0, 1};
+
+        // The alpha channel is never written, but the zero-initialized index has to differ from opaque black.
+        struct QoiPixel {
+            uint8_t r, g, b, a;
+            bool operator==(const QoiPixel &) const = default;
+        };
+
+        int qoiHash(const QoiPixel &px) { return (px.r * 3 + px.g * 5 + px.b * 7 + px.a * 11) % 64; }
+
+        void pushBigEndian(std::vector<uint8_t> &out, uint32_t value) {
+            out.push_back(static_cast<uint8_t>(value >> 24));
+            out.push_back(static_cast<uint8_t>(value >> 16));
+            out.push_back(static_cast<uint8_t>(value >> 8));
+            out.push_back(static_cast<uint8_t>(value));
+        }
+    } // namespace
+
+    std::optional<ImageFormat> parseImageFormat(std::string_view name) {
+        if (name == "png") {
+            return ImageFormat::PNG;
+        } else if (name == "qoi") {
+            return ImageFormat::QOI;
+        } else if (name == "raw") {
+            return ImageFormat::RawCounts;
+        }
+        return std::nullopt;
+    }
+
+    std::string_view imageExtension(ImageFormat format) {
+        switch (format) {
+            case ImageFormat::QOI:
+                return "qoi";
+            case ImageFormat::RawCounts:
+                return "pfm";
+            case ImageFormat::PNG:
+            default:
+                return "png";
+        }
+    }
+
+    bool writePNG(const std::string &path, const cv::Mat &image, int compression) {
+        if (compression < 0) {
+            return cv::imwrite(path, image);
+        }
+        return cv::imwrite(path, image, {cv::IMWRITE_PNG_COMPRESSION, compression});
+    }
+
+    bool writeQOI(const std::string &path, const cv::Mat &image) {
+        CV_Assert(image.type() == CV_8UC3);
+
+        // The worst case is one QOI_OP_RGB per pixel.
+        std::vector<uint8_t> out;
+        out.reserve(14 + image.total() * 4 + QOI_PADDING.size());
+        out.insert(out.end(), {'q', 'o', 'i', 'f'});
+        pushBigEndian(out, image.cols);
+        pushBigEndian(out, image.rows);
+        out.push_back(3); // RGB
+        out.push_back(0); // sRGB with linear alpha
+
+        std::array<QoiPixel, 64> index{};
+        QoiPixel prev{0, 0, 0, 255};
+        int run = 0;
+
+        for (auto y = 0; y < image.rows; ++y) {
+            const auto *row = image.ptr<cv::Vec3b>(y);
+            for (auto x = 0; x < image.cols; ++x) {
+                const QoiPixel px{row[x][2], row[x][1], row[x][0], 255};
+                if (px == prev) {
+                    if (++run == QOI_MAX_RUN) {
+                        out.push_back(QOI_OP_RUN | (run - 1));
+                        run = 0;
+                    }
+                    continue;
+                }
+
+                if (run > 0) {
+                    out.push_back(QOI_OP_RUN | (run - 1));
+                    run = 0;
+                }
+
+                const auto hash = qoiHash(px);
+                if (index[hash] == px) {
+                    out.push_back(QOI_OP_INDEX | hash);
+                } else {
+                    index[hash] = px;
+                    const auto vr = static_cast<int8_t>(px.r - prev.r);
+                    const auto vg = static_cast<int8_t>(px.g - prev.g);
+                    const auto vb = static_cast<int8_t>(px.b - prev.b);
+                    const auto vg_r = vr - vg, vg_b = vb - vg;
+
+                    if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+                        out.push_back(QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2));
+                    } else if (vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32 && vg_b > -9 && vg_b < 8) {
+                        out.push_back(QOI_OP_LUMA | (vg + 32));
+                        out.push_back((vg_r + 8) << 4 | (vg_b + 8));
+                    } else {
+                        out.insert(out.end(), {QOI_OP_RGB, px.r, px.g, px.b});
+                    }
+                }
+                prev = px;
+            }
+        }
+        if (run > 0) {
+            out.push_back(QOI_OP_RUN | (run - 1));
+        }
+        out.insert(out.end(), QOI_PADDING.begin(), QOI_PADDING.end());
+
+        return writeFile(path, out.data(), out.size());
+    }
+
+    bool writeRawCounts(const std::string &path, const cv::Mat &matrix) {
+        CV_Assert(matrix.type() == CV_32FC1);
+
+        // PFM stores the rows bottom to top, and a negative scale marks little endian data.
+        const auto header = std::format("Pf\n{} {}\n{}\n", matrix.cols, matrix.rows,
+                                        std::endian::native == std::endian::little ? "-1.0" : "1.0");
+        const auto row_bytes = matrix.cols * sizeof(float);
+        std::vector<uint8_t> out(header.size() + row_bytes * matrix.rows);
+        std::copy(header.begin(), header.end(), out.begin());
+        for (auto y = 0; y < matrix.rows; ++y) {
+            const auto *src = matrix.ptr<uint8_t>(matrix.rows - 1 - y);
+            std::copy(src, src + row_bytes, out.begin() + header.size() + y * row_bytes);
+        }
+
+        return writeFile(path, out.data(), out.size());
+    }
+
+} // namespace Mandelbrot
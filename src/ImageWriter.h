@@ -0,0 +1,66 @@
+#ifndef MANDELBROTSET_SRC_IMAGEWRITER_H
+#define MANDELBROTSET_SRC_IMAGEWRITER_H
+
+/**
+ * @file ImageWriter.h
+ * @brief Fast writers for keyframe images.
+ */
+
+#include <opencv2/core.hpp>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace Mandelbrot {
+
+    /**
+     * @brief The format of the keyframe images.
+     */
+    enum class ImageFormat {
+        PNG, ///< PNG through cv::imwrite, with a selectable compression level.
+        QOI, ///< The Quite OK Image format. Lossless and several times faster to encode than PNG.
+        RawCounts, ///< The raw escape counts as a single channel PFM file.
+    };
+
+    /**
+     * @brief Parse the image format from its command line name.
+     * @param name One of "png", "qoi" and "raw".
+     * @return The image format, or std::nullopt if the name is unknown.
+     */
+    std::optional<ImageFormat> parseImageFormat(std::string_view name);
+
+    /**
+     * @brief Get the file extension of the image format.
+     * @param format The image format.
+     * @return The extension without the leading dot.
+     */
+    std::string_view imageExtension(ImageFormat format);
+
+    /**
+     * @brief Write a PNG image.
+     * @param path The output path.
+     * @param image The image with CV_8UC3.
+     * @param compression The zlib compression level from 0 to 9, or -1 for the default of OpenCV.
+     * @return True if the image is written.
+     */
+    bool writePNG(const std::string &path, const cv::Mat &image, int compression);
+
+    /**
+     * @brief Write a QOI image.
+     * @param path The output path.
+     * @param image The image with CV_8UC3 in BGR order.
+     * @return True if the image is written.
+     */
+    bool writeQOI(const std::string &path, const cv::Mat &image);
+
+    /**
+     * @brief Write the raw escape counts as a PFM file.
+     * @param path The output path.
+     * @param matrix The raw escape time matrix with CV_32FC1.
+     * @return True if the file is written.
+     */
+    bool writeRawCounts(const std::string &path, const cv::Mat &matrix);
+
+} // namespace Mandelbrot
+
+#endif // MANDELBROTSET_SRC_IMAGEWRITER_H
@@ -5,40 +5,72 @@
 #include "MandelbrotSet.h"
 #include <opencv2/imgproc.hpp>
 #include "BaseMandelbrotSet.h"
+#include "Numa.h"
+#include "PerfCounters.h"
+#if ENABLE_OPENMP
+#include <omp.h>
+#endif
 
 namespace Mandelbrot {
-    size_t MandelbrotSet::computeEscapeTime(const std::complex<double> &c) {
-        std::complex<double> z(0.0, 0.0);
+    template<typename Formula>
+    size_t BasicMandelbrotSet<Formula>::computeEscapeTime(double x, double y) const {
+        double zr, zi, cr, ci;
+        formula_.start(x, y, zr, zi, cr, ci);
         for (auto i = 0u; i < MAX_ITERATIONS; ++i) {
-            z = z * z + c;
-            if (std::norm(z) > ESCAPE_RADIUS * ESCAPE_RADIUS) {
+            Formula::step(zr, zi, cr, ci);
+            if (zr * zr + zi * zi > ESCAPE_RADIUS_SQ) {
                 return i;
             }
         }
         return MAX_ITERATIONS;
     }
 
-    cv::Mat MandelbrotSet::generateRawMatrixImpl() const {
-        cv::Mat image(height_, width_, CV_32FC1);
+    template<typename Formula>
+    cv::Mat BasicMandelbrotSet<Formula>::generateRawMatrixImpl(RenderStats &stats) const {
+        // The rows are first written by the threads that compute them, so with pinning they live on their nodes.
+        cv::Mat image = Numa::allocate(this->height_, this->width_, CV_32FC1);
 
-        const double xscale = (x_max_ - x_min_) / width_;
-        const double yscale = (y_max_ - y_min_) / height_;
+        const auto grid = this->getGrid();
+        const double xscale = grid.xScale();
+        const double yscale = grid.yScale();
+        stats = RenderStats(static_cast<int>(this->width_), static_cast<int>(this->height_), MAX_ITERATIONS);
 
 #if ENABLE_OPENMP
-#pragma omp parallel for
+        const int thread_count = thread_count_ > 0 ? thread_count_ : omp_get_max_threads();
+        useSchedule(schedule_, chunk_);
+#pragma omp parallel num_threads(thread_count)
+#endif
+        {
+            // Counters are per thread, so every thread of the team counts its own share.
+            Perf::Scope perf_scope("generateRawMatrix");
+            // Count into a private copy and merge once, so the threads never share a counter.
+            RenderStats local(static_cast<int>(this->width_), static_cast<int>(this->height_), MAX_ITERATIONS);
+#if ENABLE_OPENMP
+#pragma omp for schedule(runtime) nowait
 #endif
-        for (auto y = 0; y < height_; ++y) {
-            for (auto x = 0; x < width_; ++x) {
-                double xcoord = x_min_ + x * xscale;
-                double ycoord = y_min_ + y * yscale;
-                std::complex<double> c(xcoord, ycoord);
-                size_t escape_time = computeEscapeTime(c);
-                image.at<float>(y, x) = static_cast<float>(escape_time);
+            for (auto y = 0; y < this->height_; ++y) {
+                for (auto x = 0; x < this->width_; ++x) {
+                    double xcoord = grid.x_min + (grid.x_offset + x) * xscale;
+                    double ycoord = grid.y_min + (grid.y_offset + y) * yscale;
+                    size_t escape_time = computeEscapeTime(xcoord, ycoord);
+                    image.at<float>(y, x) = static_cast<float>(escape_time);
+                    local.add(x, y, escape_time);
+                }
             }
+#if ENABLE_OPENMP
+#pragma omp critical
+#endif
+            stats.merge(local);
         }
 
         return image;
     }
 
+    template class BasicMandelbrotSet<MandelbrotFormula>;
+    template class BasicMandelbrotSet<JuliaFormula>;
+    template class BasicMandelbrotSet<BurningShipFormula>;
+    template class BasicMandelbrotSet<MultibrotFormula<3>>;
+    template class BasicMandelbrotSet<MultibrotFormula<4>>;
+    template class BasicMandelbrotSet<MultibrotFormula<5>>;
 
 } // namespace Mandelbrot
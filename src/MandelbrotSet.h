@@ -9,26 +9,79 @@
  * @file MandelbrotSet.h
  */
 
-#include <complex>
 #include <opencv2/core/mat.hpp>
 #include "BaseMandelbrotSet.h"
+#include "Formula.h"
+#include "Tuning.h"
 
 namespace Mandelbrot {
 
-    class MandelbrotSet : public BaseMandelbrotSet<MandelbrotSet> {
-        using Base = BaseMandelbrotSet<MandelbrotSet>;
+    /**
+     * @brief The CPU implementation.
+     * @tparam Formula The iteration formula, see Formula.h.
+     * @note The formulas are explicitly instantiated in MandelbrotSet.cpp.
+     */
+    template<typename Formula>
+    class BasicMandelbrotSet : public BaseMandelbrotSet<BasicMandelbrotSet<Formula>> {
+        using Base = BaseMandelbrotSet<BasicMandelbrotSet<Formula>>;
 
     public:
         friend Base;
 
-        MandelbrotSet() = default;
-        MandelbrotSet(const size_t width, const size_t height) : BaseMandelbrotSet(width, height) {}
+        BasicMandelbrotSet() = default;
+        BasicMandelbrotSet(const size_t width, const size_t height) : Base(width, height) {}
+
+        /**
+         * @brief Set the parameters of the formula, e.g. the constant of a Julia set.
+         */
+        BasicMandelbrotSet &setFormula(const Formula &formula) {
+            formula_ = formula;
+            return *this;
+        }
+
+        [[nodiscard]] const Formula &getFormula() const { return formula_; }
+
+        /**
+         * @brief Set the OpenMP threads of a render.
+         * @param thread_count The thread count. Zero uses the OpenMP default.
+         * @note Use one thread when the renders themselves run concurrently on a thread pool.
+         */
+        BasicMandelbrotSet &setThreadCount(int thread_count) {
+            thread_count_ = thread_count;
+            return *this;
+        }
+
+        [[nodiscard]] int getThreadCount() const { return thread_count_; }
+
+        /**
+         * @brief Set how the rows are spread over the threads, see Tuning.h.
+         * @param chunk The rows a thread takes at a time. Zero uses the default of the schedule.
+         */
+        BasicMandelbrotSet &setSchedule(Schedule schedule, int chunk = 0) {
+            schedule_ = schedule;
+            chunk_ = chunk;
+            return *this;
+        }
 
     private:
-        [[nodiscard]] cv::Mat generateRawMatrixImpl() const;
-        [[nodiscard]] static size_t computeEscapeTime(const std::complex<double> &c);
+        [[nodiscard]] cv::Mat generateRawMatrixImpl(RenderStats &stats) const;
+        [[nodiscard]] size_t computeEscapeTime(double x, double y) const;
+
+        Formula formula_{};
+        int thread_count_{0};
+        Schedule schedule_{Schedule::Static};
+        int chunk_{0};
     };
 
+    using MandelbrotSet = BasicMandelbrotSet<MandelbrotFormula>;
+
+    extern template class BasicMandelbrotSet<MandelbrotFormula>;
+    extern template class BasicMandelbrotSet<JuliaFormula>;
+    extern template class BasicMandelbrotSet<BurningShipFormula>;
+    extern template class BasicMandelbrotSet<MultibrotFormula<3>>;
+    extern template class BasicMandelbrotSet<MultibrotFormula<4>>;
+    extern template class BasicMandelbrotSet<MultibrotFormula<5>>;
+
 } // namespace Mandelbrot
 
 #endif // MANDELBROTSET_INCLUDE_MANDELBROT_MANDELBROTSET_H
@@ -20,15 +20,16 @@ namespace Mandelbrot {
 
     __global__ void mandelbrotKernelWithoutColor(float *image, // NOLINT
                                                  size_t width, size_t height, // NOLINT
-                                                 double x_min, double x_max, // NOLINT
-                                                 double y_min, double y_max) {
+                                                 PixelGrid pixel_grid) {
         const int x = blockIdx.x * blockDim.x + threadIdx.x;
         const int y = blockIdx.y * blockDim.y + threadIdx.y;
         if (x >= width || y >= height) {
             return;
         }
-        const ComputeDouble cr{x_min + (x_max - x_min) * x / width};
-        const ComputeDouble ci{y_min + (y_max - y_min) * y / height};
+        // The pixel is placed on the grid of the whole image, so a region renders the same points, see PixelGrid.
+        const auto &g = pixel_grid;
+        const ComputeDouble cr{g.x_min + (g.x_max - g.x_min) * (g.x_offset + x) / g.width};
+        const ComputeDouble ci{g.y_min + (g.y_max - g.y_min) * (g.y_offset + y) / g.height};
 
         ComputeDouble zr{0.0}, zi{0.0};
         unsigned int n = 0;
@@ -47,14 +48,19 @@ namespace Mandelbrot {
         image[idx] = n;
     }
 
-    cv::Mat MandelbrotSetCuda::generateRawMatrixImpl() const {
+    bool MandelbrotSetCuda::available() {
+        int count = 0;
+        return cudaGetDeviceCount(&count) == cudaSuccess && count > 0;
+    }
+
+    cv::Mat MandelbrotSetCuda::generateRawMatrixImpl(RenderStats &) const {
         float *d_image;
         CHECK_CUDA(cudaMalloc(&d_image, width_ * height_ * sizeof(int)));
 
         dim3 block(BLOCK_SIZE, BLOCK_SIZE);
         dim3 grid((width_ + block.x - 1) / block.x, (height_ + block.y - 1) / block.y);
 
-        mandelbrotKernelWithoutColor<<<grid, block>>>(d_image, width_, height_, x_min_, x_max_, y_min_, y_max_);
+        mandelbrotKernelWithoutColor<<<grid, block>>>(d_image, width_, height_, getGrid());
 
         cv::Mat image(height_, width_, CV_32FC1);
         CHECK_CUDA(cudaMemcpy(image.data, d_image, width_ * height_ * sizeof(int), cudaMemcpyDeviceToHost));
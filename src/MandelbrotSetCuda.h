@@ -17,8 +17,16 @@ namespace Mandelbrot {
 
         constexpr static int BLOCK_SIZE = 16;
 
+        /**
+         * @brief Whether a CUDA device is present. Rendering without one exits the process.
+         */
+        static bool available();
+
     private:
-        [[nodiscard]] cv::Mat generateRawMatrixImpl() const;
+        /**
+         * @brief Render on the device. The statistics are left to be counted from the matrix.
+         */
+        [[nodiscard]] cv::Mat generateRawMatrixImpl(RenderStats &) const;
     };
 } // namespace Mandelbrot
 
@@ -0,0 +1,88 @@
+#include "MandelbrotSetSimd.h"
+#include <algorithm>
+#include "Numa.h"
+#include "PerfCounters.h"
+#if ENABLE_OPENMP
+#include <omp.h>
+#endif
+
+namespace Mandelbrot {
+    template<typename Formula, int LANES>
+    cv::Mat BasicMandelbrotSetSimd<Formula, LANES>::generateRawMatrixImpl(RenderStats &stats) const {
+        using Group = Lanes<LANES>;
+        cv::Mat image = Numa::allocate(this->height_, this->width_, CV_32FC1);
+
+        const auto width = static_cast<int>(this->width_), height = static_cast<int>(this->height_);
+        const auto grid = this->getGrid();
+        const double xscale = grid.xScale();
+        const double yscale = grid.yScale();
+        stats = RenderStats(width, height, MAX_ITERATIONS);
+
+#if ENABLE_OPENMP
+        const int thread_count = thread_count_ > 0 ? thread_count_ : omp_get_max_threads();
+        useSchedule(schedule_, chunk_);
+#pragma omp parallel num_threads(thread_count)
+#endif
+        {
+            Perf::Scope perf_scope("generateRawMatrix");
+            RenderStats local(width, height, MAX_ITERATIONS);
+#if ENABLE_OPENMP
+#pragma omp for schedule(runtime) nowait
+#endif
+            for (auto y = 0; y < height; ++y) {
+                auto *row = image.ptr<float>(y);
+                for (auto x0 = 0; x0 < width; x0 += LANES) {
+                    // The lanes past the end of the row are computed and dropped.
+                    Group xcoord;
+                    for (int i = 0; i < LANES; ++i) {
+                        xcoord.v[i] = grid.x_min + (grid.x_offset + x0 + i) * xscale;
+                    }
+                    Group zr, zi, cr, ci;
+                    formula_.start(xcoord, Group(grid.y_min + (grid.y_offset + y) * yscale), zr, zi, cr, ci);
+
+                    // The escaped lanes keep iterating, so the loop has no branch per lane. Their escape time is
+                    // kept by the mask.
+                    uint64_t escape_time[LANES];
+                    std::fill_n(escape_time, LANES, MAX_ITERATIONS);
+                    for (uint64_t n = 0; n < MAX_ITERATIONS; ++n) {
+                        Formula::step(zr, zi, cr, ci);
+                        bool all_escaped = true;
+                        for (int i = 0; i < LANES; ++i) {
+                            const bool escaped = zr.v[i] * zr.v[i] + zi.v[i] * zi.v[i] > ESCAPE_RADIUS_SQ;
+                            escape_time[i] = escaped && escape_time[i] == MAX_ITERATIONS ? n : escape_time[i];
+                            all_escaped &= escape_time[i] != MAX_ITERATIONS;
+                        }
+                        if (all_escaped) {
+                            break;
+                        }
+                    }
+
+                    for (auto i = 0; i < std::min(LANES, width - x0); ++i) {
+                        row[x0 + i] = static_cast<float>(escape_time[i]);
+                        local.add(x0 + i, y, escape_time[i]);
+                    }
+                }
+            }
+#if ENABLE_OPENMP
+#pragma omp critical
+#endif
+            stats.merge(local);
+        }
+
+        return image;
+    }
+
+    template class BasicMandelbrotSetSimd<MandelbrotFormula, 4>;
+    template class BasicMandelbrotSetSimd<MandelbrotFormula, 8>;
+    template class BasicMandelbrotSetSimd<JuliaFormula, 4>;
+    template class BasicMandelbrotSetSimd<JuliaFormula, 8>;
+    template class BasicMandelbrotSetSimd<BurningShipFormula, 4>;
+    template class BasicMandelbrotSetSimd<BurningShipFormula, 8>;
+    template class BasicMandelbrotSetSimd<MultibrotFormula<3>, 4>;
+    template class BasicMandelbrotSetSimd<MultibrotFormula<3>, 8>;
+    template class BasicMandelbrotSetSimd<MultibrotFormula<4>, 4>;
+    template class BasicMandelbrotSetSimd<MultibrotFormula<4>, 8>;
+    template class BasicMandelbrotSetSimd<MultibrotFormula<5>, 4>;
+    template class BasicMandelbrotSetSimd<MultibrotFormula<5>, 8>;
+
+} // namespace Mandelbrot
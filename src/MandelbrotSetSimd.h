@@ -0,0 +1,135 @@
+#ifndef MANDELBROTSET_SRC_MANDELBROTSETSIMD_H
+#define MANDELBROTSET_SRC_MANDELBROTSETSIMD_H
+
+/**
+ * @file MandelbrotSetSimd.h
+ * @brief The lane-batched CPU implementation.
+ *
+ * A row is iterated LANES pixels at a time. The lanes are plain arrays with element-wise operators, so the compiler
+ * turns the formula steps into vector instructions of whatever width the target supports, without intrinsics. A group
+ * runs until all of its lanes escaped, so it pays off where neighbouring pixels have similar escape times.
+ */
+
+#include <cmath>
+#include <opencv2/core/mat.hpp>
+#include "BaseMandelbrotSet.h"
+#include "Formula.h"
+#include "Tuning.h"
+
+namespace Mandelbrot {
+
+    /**
+     * @brief N doubles that are computed together.
+     */
+    template<int N>
+    struct Lanes {
+        double v[N];
+
+        Lanes() = default;
+        explicit Lanes(double value) {
+            for (int i = 0; i < N; ++i) {
+                v[i] = value;
+            }
+        }
+
+        friend Lanes operator+(Lanes a, const Lanes &b) {
+            for (int i = 0; i < N; ++i) {
+                a.v[i] += b.v[i];
+            }
+            return a;
+        }
+
+        friend Lanes operator-(Lanes a, const Lanes &b) {
+            for (int i = 0; i < N; ++i) {
+                a.v[i] -= b.v[i];
+            }
+            return a;
+        }
+
+        friend Lanes operator*(Lanes a, const Lanes &b) {
+            for (int i = 0; i < N; ++i) {
+                a.v[i] *= b.v[i];
+            }
+            return a;
+        }
+
+        friend Lanes abs(Lanes a) {
+            for (int i = 0; i < N; ++i) {
+                a.v[i] = std::abs(a.v[i]);
+            }
+            return a;
+        }
+    };
+
+    /**
+     * @brief The CPU implementation that iterates several pixels at once.
+     * @tparam Formula The iteration formula, see Formula.h.
+     * @tparam LANES The pixels of a group.
+     * @note The escape times are the same as the ones of BasicMandelbrotSet, unless the compiler contracts the
+     *       multiplications and additions differently in the two loops.
+     */
+    template<typename Formula, int LANES>
+    class BasicMandelbrotSetSimd : public BaseMandelbrotSet<BasicMandelbrotSetSimd<Formula, LANES>> {
+        using Base = BaseMandelbrotSet<BasicMandelbrotSetSimd<Formula, LANES>>;
+
+    public:
+        friend Base;
+
+        BasicMandelbrotSetSimd() = default;
+        BasicMandelbrotSetSimd(const size_t width, const size_t height) : Base(width, height) {}
+
+        BasicMandelbrotSetSimd &setFormula(const Formula &formula) {
+            formula_ = formula;
+            return *this;
+        }
+
+        [[nodiscard]] const Formula &getFormula() const { return formula_; }
+
+        /**
+         * @brief Set the OpenMP threads of a render. Zero uses the OpenMP default.
+         */
+        BasicMandelbrotSetSimd &setThreadCount(int thread_count) {
+            thread_count_ = thread_count;
+            return *this;
+        }
+
+        [[nodiscard]] int getThreadCount() const { return thread_count_; }
+
+        /**
+         * @brief Set how the rows are spread over the threads, see Tuning.h.
+         * @param chunk The rows a thread takes at a time. Zero uses the default of the schedule.
+         */
+        BasicMandelbrotSetSimd &setSchedule(Schedule schedule, int chunk = 0) {
+            schedule_ = schedule;
+            chunk_ = chunk;
+            return *this;
+        }
+
+    private:
+        [[nodiscard]] cv::Mat generateRawMatrixImpl(RenderStats &stats) const;
+
+        Formula formula_{};
+        int thread_count_{0};
+        Schedule schedule_{Schedule::Dynamic};
+        int chunk_{0};
+    };
+
+    using MandelbrotSetSimd4 = BasicMandelbrotSetSimd<MandelbrotFormula, 4>;
+    using MandelbrotSetSimd8 = BasicMandelbrotSetSimd<MandelbrotFormula, 8>;
+
+    extern template class BasicMandelbrotSetSimd<MandelbrotFormula, 4>;
+    extern template class BasicMandelbrotSetSimd<MandelbrotFormula, 8>;
+    extern template class BasicMandelbrotSetSimd<JuliaFormula, 4>;
+    extern template class BasicMandelbrotSetSimd<JuliaFormula, 8>;
+    extern template class BasicMandelbrotSetSimd<BurningShipFormula, 4>;
+    extern template class BasicMandelbrotSetSimd<BurningShipFormula, 8>;
+    extern template class BasicMandelbrotSetSimd<MultibrotFormula<3>, 4>;
+    extern template class BasicMandelbrotSetSimd<MultibrotFormula<3>, 8>;
+    extern template class BasicMandelbrotSetSimd<MultibrotFormula<4>, 4>;
+    extern template class BasicMandelbrotSetSimd<MultibrotFormula<4>, 8>;
+    extern template class BasicMandelbrotSetSimd<MultibrotFormula<5>, 4>;
+    extern template class BasicMandelbrotSetSimd<MultibrotFormula<5>, 8>;
+
+} // namespace Mandelbrot
+
+#endif // MANDELBROTSET_SRC_MANDELBROTSETSIMD_H
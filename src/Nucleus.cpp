@@ -0,0 +1,114 @@
+#include "Nucleus.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+namespace Mandelbrot {
+    namespace {
+        // Only guards against overflow. Escaped corners still move the polygon the right way around the origin.
+        constexpr long double BOX_ESCAPE_NORM = 1e64L;
+
+        /**
+         * @brief Whether a polygon surrounds the origin, by the even-odd rule on the positive real axis.
+         */
+        bool surroundsOrigin(const std::array<ComplexLD, 4> &polygon) {
+            bool inside = false;
+            for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+                const auto &a = polygon[i], &b = polygon[j];
+                if ((a.imag() > 0) != (b.imag() > 0) &&
+                    0 < a.real() + (b.real() - a.real()) * (0 - a.imag()) / (b.imag() - a.imag())) {
+                    inside = !inside;
+                }
+            }
+            return inside;
+        }
+
+        /**
+         * @brief The smallest divisor of period after which the orbit of the nucleus returns to zero.
+         * @note Newton's method on z_p also converges to the nuclei whose period divides p.
+         */
+        int exactPeriod(ComplexLD nucleus, int period) {
+            constexpr long double tolerance = 1e-10L;
+            ComplexLD z = 0;
+            for (int n = 1; n < period; ++n) {
+                z = z * z + nucleus;
+                if (period % n == 0 && std::abs(z) <= tolerance) {
+                    return n;
+                }
+            }
+            return period;
+        }
+    } // namespace
+
+    std::optional<int> boxPeriod(ComplexLD center, long double radius, int max_period) {
+        const std::array<ComplexLD, 4> corners{
+                center + ComplexLD(-radius, -radius),
+                center + ComplexLD(radius, -radius),
+                center + ComplexLD(radius, radius),
+                center + ComplexLD(-radius, radius),
+        };
+        auto z = std::array<ComplexLD, 4>{};
+        for (int period = 1; period <= max_period; ++period) {
+            for (size_t i = 0; i < z.size(); ++i) {
+                z[i] = z[i] * z[i] + corners[i];
+                if (std::norm(z[i]) > BOX_ESCAPE_NORM) {
+                    return std::nullopt;
+                }
+            }
+            if (surroundsOrigin(z)) {
+                return period;
+            }
+        }
+        return std::nullopt;
+    }
+
+    std::optional<ComplexLD> nucleusNewton(ComplexLD guess, int period) {
+        constexpr auto epsilon = 16 * std::numeric_limits<long double>::epsilon();
+        auto c = guess;
+        for (int step = 0; step < NUCLEUS_NEWTON_STEPS; ++step) {
+            // z and its derivative dz/dc along the first period.
+            ComplexLD z = 0, dz = 0;
+            for (int n = 0; n < period; ++n) {
+                dz = 2.0L * z * dz + 1.0L;
+                z = z * z + c;
+            }
+            const auto delta = z / dz;
+            c -= delta;
+            if (!std::isfinite(c.real()) || !std::isfinite(c.imag())) {
+                return std::nullopt;
+            }
+            if (std::abs(delta) <= epsilon * std::max(1.0L, std::abs(c))) {
+                return c;
+            }
+        }
+        return std::nullopt;
+    }
+
+    long double nucleusSize(ComplexLD nucleus, int period) {
+        ComplexLD z = 0, l = 1, b = 1;
+        for (int n = 1; n < period; ++n) {
+            z = z * z + nucleus;
+            l = 2.0L * z * l;
+            b += 1.0L / l;
+        }
+        return 1.0L / std::abs(b * l * l);
+    }
+
+    std::optional<Nucleus> findNucleus(ComplexLD center, long double radius, long double max_radius) {
+        for (auto box = std::min(radius, max_radius); box <= max_radius; box *= 2) {
+            const auto period = boxPeriod(center, box);
+            if (!period) {
+                continue;
+            }
+            const auto nucleus = nucleusNewton(center, *period);
+            if (nucleus && std::abs(nucleus->real() - center.real()) <= box &&
+                std::abs(nucleus->imag() - center.imag()) <= box) {
+                const auto exact = exactPeriod(*nucleus, *period);
+                return Nucleus{*nucleus, exact, nucleusSize(*nucleus, exact)};
+            }
+        }
+        return std::nullopt;
+    }
+
+} // namespace Mandelbrot
@@ -0,0 +1,73 @@
+#ifndef MANDELBROTSET_SRC_NUCLEUS_H
+#define MANDELBROTSET_SRC_NUCLEUS_H
+
+/**
+ * @file Nucleus.h
+ * @brief Locate the nucleus of a minibrot near a point of the Mandelbrot set.
+ *
+ * The nucleus of a hyperbolic component of period p is a root of z_p(c) = 0, where z_0 = 0 and z_{n+1} = z_n^2 + c.
+ * Its period is found with the box method: the corners of a box around the point are iterated together, and the first
+ * iteration whose corner polygon surrounds the origin is the lowest period of a nucleus inside the box. Newton's method
+ * on z_p(c) from the center of the box then converges to the nucleus quadratically.
+ *
+ * Everything runs in long double, so the nucleus is precise to about 1e-19 relative, beyond the depth of the double
+ * precision renders.
+ */
+
+#include <complex>
+#include <optional>
+
+namespace Mandelbrot {
+
+    using ComplexLD = std::complex<long double>;
+
+    /**
+     * @brief A located nucleus.
+     */
+    struct Nucleus {
+        ComplexLD c;
+        int period;
+        long double size; ///< The estimated radius of its minibrot.
+    };
+
+    constexpr int MAX_NUCLEUS_PERIOD = 1 << 16;
+    constexpr int NUCLEUS_NEWTON_STEPS = 64;
+
+    /**
+     * @brief The lowest period of a nucleus inside a box, with the box method.
+     * @param center The center of the box.
+     * @param radius The half width of the box.
+     * @param max_period The longest period to try.
+     * @return The period, or std::nullopt if no corner polygon surrounded the origin.
+     */
+    std::optional<int> boxPeriod(ComplexLD center, long double radius, int max_period = MAX_NUCLEUS_PERIOD);
+
+    /**
+     * @brief Refine a nucleus with Newton's method on z_p(c).
+     * @param guess The start of the iteration.
+     * @param period The period of the nucleus.
+     * @return The nucleus, or std::nullopt if the iteration diverges or does not settle.
+     */
+    std::optional<ComplexLD> nucleusNewton(ComplexLD guess, int period);
+
+    /**
+     * @brief Estimate the radius of the minibrot of a nucleus.
+     * @note The estimate of Heiland-Allen: 1 / |b l^2|, with l the derivative of the orbit and b the sum of 1 / l
+     *       along the first period. It is good to a small factor, which is enough to frame the minibrot.
+     */
+    long double nucleusSize(ComplexLD nucleus, int period);
+
+    /**
+     * @brief Locate the deepest nucleus that can be pinned down near a point.
+     * @param center The point, usually on the boundary of the set.
+     * @param radius The half width of the first box, i.e. about the size of the view the nucleus is wanted for.
+     * @param max_radius The half width of the last box. The box doubles until a nucleus is found inside.
+     * @return The nucleus, or std::nullopt if none was found up to max_radius.
+     * @note A smaller box has a longer period and a smaller minibrot, but also a smaller basin for Newton's method.
+     *       A nucleus only counts if it lies inside the box that produced its period.
+     */
+    std::optional<Nucleus> findNucleus(ComplexLD center, long double radius, long double max_radius);
+
+} // namespace Mandelbrot
+
+#endif // MANDELBROTSET_SRC_NUCLEUS_H
@@ -0,0 +1,267 @@
+#include "Numa.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#if ENABLE_OPENMP
+#include <omp.h>
+#endif
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+namespace Mandelbrot::Numa {
+    namespace {
+        constexpr size_t HUGE_PAGE_SIZE = size_t{2} << 20;
+
+        std::atomic<bool> pinning_enabled{false};
+        std::atomic<bool> huge_pages_enabled{false};
+
+        /**
+         * @brief Parse a sysfs CPU list such as "0-3,8-11".
+         */
+        std::vector<int> parseCpuList(const std::string &list) {
+            std::vector<int> cpus;
+            std::stringstream stream(list);
+            std::string range;
+            while (std::getline(stream, range, ',')) {
+                if (range.empty() || !std::isdigit(static_cast<unsigned char>(range.front()))) {
+                    continue;
+                }
+                const auto dash = range.find('-');
+                const auto first = std::stoi(range.substr(0, dash));
+                const auto last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+                for (auto cpu = first; cpu <= last; ++cpu) {
+                    cpus.push_back(cpu);
+                }
+            }
+            return cpus;
+        }
+
+        std::vector<int> allowedCpus() {
+            std::vector<int> cpus;
+#ifdef __linux__
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+                for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                    if (CPU_ISSET(cpu, &set)) {
+                        cpus.push_back(cpu);
+                    }
+                }
+            }
+#endif
+            if (cpus.empty()) {
+                for (int cpu = 0; cpu < static_cast<int>(std::max(1u, std::thread::hardware_concurrency())); ++cpu) {
+                    cpus.push_back(cpu);
+                }
+            }
+            return cpus;
+        }
+
+        std::vector<Node> detectNodes() {
+            const auto allowed = allowedCpus();
+            std::vector<Node> result;
+#ifdef __linux__
+            std::error_code error;
+            for (const auto &entry: std::filesystem::directory_iterator("/sys/devices/system/node", error)) {
+                const auto name = entry.path().filename().string();
+                if (name.size() <= 4 || !name.starts_with("node") ||
+                    !std::all_of(name.begin() + 4, name.end(), [](unsigned char c) { return std::isdigit(c); })) {
+                    continue;
+                }
+                std::ifstream file(entry.path() / "cpulist");
+                std::string list;
+                std::getline(file, list);
+                Node node{std::stoi(name.substr(4)), {}};
+                for (const auto cpu: parseCpuList(list)) {
+                    if (std::ranges::find(allowed, cpu) != allowed.end()) {
+                        node.cpus.push_back(cpu);
+                    }
+                }
+                if (!node.cpus.empty()) {
+                    result.push_back(std::move(node));
+                }
+            }
+            std::ranges::sort(result, {}, &Node::id);
+#endif
+            if (result.empty()) {
+                result.push_back({0, allowed});
+            }
+            return result;
+        }
+
+#ifdef __linux__
+        /**
+         * @brief Map the large buffers directly from the kernel, aligned to and advised for huge pages.
+         * @note The pages are only backed on the first write, on the NUMA node of the writing thread.
+         */
+        class HugePageAllocator : public cv::MatAllocator {
+        public:
+            cv::UMatData *allocate(int dims, const int *sizes, int type, void *data0, size_t *step, cv::AccessFlag,
+                                   cv::UMatUsageFlags) const override {
+                size_t total = CV_ELEM_SIZE(type);
+                for (int i = dims - 1; i >= 0; --i) {
+                    if (step) {
+                        if (data0 && step[i] != CV_AUTOSTEP) {
+                            CV_Assert(total <= step[i]);
+                            total = step[i];
+                        } else {
+                            step[i] = total;
+                        }
+                    }
+                    total *= sizes[i];
+                }
+
+                auto *data = static_cast<uchar *>(data0);
+                if (!data) {
+                    data = total < HUGE_PAGE_SIZE ? static_cast<uchar *>(cv::fastMalloc(total)) : map(total);
+                }
+                auto *u = new cv::UMatData(this);
+                u->data = u->origdata = data;
+                u->size = total;
+                if (data0) {
+                    u->flags |= cv::UMatData::USER_ALLOCATED;
+                }
+                return u;
+            }
+
+            bool allocate(cv::UMatData *u, cv::AccessFlag, cv::UMatUsageFlags) const override { return u != nullptr; }
+
+            void deallocate(cv::UMatData *u) const override {
+                if (!u) {
+                    return;
+                }
+                CV_Assert(u->urefcount == 0 && u->refcount == 0);
+                if (!(u->flags & cv::UMatData::USER_ALLOCATED)) {
+                    if (u->size < HUGE_PAGE_SIZE) {
+                        cv::fastFree(u->origdata);
+                    } else {
+                        munmap(u->origdata, roundUp(u->size));
+                    }
+                    u->origdata = nullptr;
+                }
+                delete u;
+            }
+
+        private:
+            static size_t roundUp(size_t size) { return (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE; }
+
+            static uchar *map(size_t size) {
+                const auto length = roundUp(size);
+                // Map one huge page more and trim both ends, so that the buffer starts on a huge page boundary.
+                auto *raw = static_cast<uchar *>(mmap(nullptr, length + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                                                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+                if (raw == MAP_FAILED) {
+                    throw std::bad_alloc();
+                }
+                const auto address = reinterpret_cast<uintptr_t>(raw);
+                auto *aligned = raw + ((HUGE_PAGE_SIZE - address % HUGE_PAGE_SIZE) % HUGE_PAGE_SIZE);
+                if (aligned > raw) {
+                    munmap(raw, aligned - raw);
+                }
+                if (auto *end = aligned + length; end < raw + length + HUGE_PAGE_SIZE) {
+                    munmap(end, raw + length + HUGE_PAGE_SIZE - end);
+                }
+                // Without transparent huge pages the advice fails, and the buffer is still a valid mapping.
+                madvise(aligned, length, MADV_HUGEPAGE);
+                return aligned;
+            }
+        };
+#endif
+    } // namespace
+
+    bool enable(bool pin, bool huge_pages) {
+        if (!AVAILABLE) {
+            return false;
+        }
+        // Read the topology before any thread is pinned, so that it covers all CPUs of the process.
+        [[maybe_unused]] const auto &topology = nodes();
+        pinning_enabled = pin;
+        huge_pages_enabled = huge_pages;
+        return true;
+    }
+
+    bool pinning() { return pinning_enabled.load(std::memory_order_relaxed); }
+
+    bool hugePages() { return huge_pages_enabled.load(std::memory_order_relaxed); }
+
+    const std::vector<Node> &nodes() {
+        static const auto topology = detectNodes();
+        return topology;
+    }
+
+    std::span<const int> threadCpus(size_t index, size_t count) {
+        const auto &topology = nodes();
+        const auto node = count == 0 ? 0 : index % count * topology.size() / count;
+        return topology[node].cpus;
+    }
+
+    bool pinCurrentThread(std::span<const int> cpus) {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (const auto cpu: cpus) {
+            CPU_SET(cpu, &set);
+        }
+        return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+        return false;
+#endif
+    }
+
+    void pinOpenMPThreads() {
+        if (!pinning()) {
+            return;
+        }
+#if ENABLE_OPENMP
+#pragma omp parallel
+        {
+            // The calling thread is thread 0 too, which touches the first rows of every static schedule first.
+            pinCurrentThread(threadCpus(omp_get_thread_num(), omp_get_num_threads()));
+        }
+#endif
+    }
+
+    void pinOpenMPTeam() {
+        if (!pinning()) {
+            return;
+        }
+#if defined(__linux__) && ENABLE_OPENMP
+        cpu_set_t set;
+        if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+            return;
+        }
+#pragma omp parallel
+        {
+            sched_setaffinity(0, sizeof(set), &set);
+        }
+#endif
+    }
+
+    cv::MatAllocator *allocator() {
+#ifdef __linux__
+        static HugePageAllocator huge_page_allocator;
+        if (hugePages()) {
+            return &huge_page_allocator;
+        }
+#endif
+        return nullptr;
+    }
+
+    cv::Mat allocate(int rows, int cols, int type) {
+        cv::Mat mat;
+        mat.allocator = allocator();
+        mat.create(rows, cols, type);
+        return mat;
+    }
+
+} // namespace Mandelbrot::Numa
@@ -0,0 +1,105 @@
+#ifndef MANDELBROTSET_SRC_NUMA_H
+#define MANDELBROTSET_SRC_NUMA_H
+
+/**
+ * @file Numa.h
+ * @brief Opt-in thread pinning and huge-page buffers for multi-socket hosts.
+ *
+ * Linux places a page on the NUMA node of the thread that first writes it. The large buffers, i.e. the raw matrix,
+ * the colored image and the video frames, are therefore only useful to pin if the threads that fill them stay on the
+ * same node, and the buffers are not touched before.
+ *
+ * With pinning, thread i of n runs on the NUMA node i * nodes / n, so the contiguous rows of a static schedule are
+ * owned by one node. With huge pages, the buffers are mapped fresh from the kernel with MADV_HUGEPAGE, so they are not
+ * touched until the owning threads fill them, and cost a fraction of the TLB entries.
+ *
+ * Both are only available on Linux. Pinning covers the OpenMP threads and the thread pools that pin themselves with
+ * threadCpus.
+ */
+
+#include <cstddef>
+#include <opencv2/core.hpp>
+#include <span>
+#include <vector>
+
+namespace Mandelbrot::Numa {
+
+#ifdef __linux__
+    constexpr bool AVAILABLE = true;
+#else
+    constexpr bool AVAILABLE = false;
+#endif
+
+    /**
+     * @brief A NUMA node and the CPUs of it that this process may run on.
+     */
+    struct Node {
+        int id;
+        std::vector<int> cpus;
+    };
+
+    /**
+     * @brief Enable the layer. Buffers allocated and threads started before this call are not affected.
+     * @param pin Pin the threads to the NUMA nodes.
+     * @param huge_pages Allocate the large buffers with huge pages.
+     * @return False if the layer is not available on this platform.
+     */
+    bool enable(bool pin, bool huge_pages);
+
+    /**
+     * @brief Whether the threads are pinned.
+     */
+    bool pinning();
+
+    /**
+     * @brief Whether the large buffers use huge pages.
+     */
+    bool hugePages();
+
+    /**
+     * @brief The NUMA nodes. A host without NUMA, or without sysfs, is a single node with all allowed CPUs.
+     */
+    const std::vector<Node> &nodes();
+
+    /**
+     * @brief The CPUs of thread index of count, i.e. those of its NUMA node.
+     */
+    std::span<const int> threadCpus(size_t index, size_t count);
+
+    /**
+     * @brief Pin the calling thread to a set of CPUs.
+     * @return Whether the affinity was changed.
+     */
+    bool pinCurrentThread(std::span<const int> cpus);
+
+    /**
+     * @brief Pin the threads of the default OpenMP team, including the calling thread. Does nothing unless pinning
+     *        is enabled.
+     * @note OpenMP keeps its threads between parallel regions, so later teams of the same size stay pinned. Threads
+     *       started afterwards inherit the CPUs of the calling thread, i.e. those of the first node, so every thread
+     *       pool pins its own workers with threadCpus, see onEveryThread in Utility.h.
+     */
+    void pinOpenMPThreads();
+
+    /**
+     * @brief Pin the threads of the OpenMP team of the calling thread to the CPUs of the calling thread. Does nothing
+     *        unless pinning is enabled.
+     * @note For the workers of a pinned thread pool that start teams of their own. Every such thread has a team of its
+     *       own, which pinOpenMPThreads does not reach. Set the team size first.
+     */
+    void pinOpenMPTeam();
+
+    /**
+     * @brief The allocator of the large buffers, or nullptr for the default one.
+     */
+    cv::MatAllocator *allocator();
+
+    /**
+     * @brief Allocate a large buffer without touching it.
+     * @note Fill the buffer with the threads that use it later, e.g. with the same static OpenMP schedule.
+     */
+    cv::Mat allocate(int rows, int cols, int type);
+
+} // namespace Mandelbrot::Numa
+
+#endif // MANDELBROTSET_SRC_NUMA_H
@@ -0,0 +1,194 @@
+#include "PerfCounters.h"
+#include <array>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string_view>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Mandelbrot::Perf {
+
+    namespace {
+        struct StageStats {
+            uint64_t calls = 0;
+            uint64_t counted = 0; ///< The calls whose counters were on the PMU for part of the scope.
+            double seconds = 0;
+            std::array<double, COUNTER_COUNT> counts{}; ///< Scaled to the time the counters were enabled.
+            // A counter is only reported if every scope of the stage could read it.
+            std::array<bool, COUNTER_COUNT> valid{true, true, true, true};
+            uint64_t time_enabled = 0, time_running = 0;
+        };
+
+        std::atomic<bool> counting{false};
+        std::mutex stages_mutex;
+        std::map<std::string_view, StageStats> stages;
+
+        /**
+         * @brief The counter group of one thread. It is closed when the thread exits.
+         */
+        struct ThreadCounters {
+            std::array<int, COUNTER_COUNT> fds{-1, -1, -1, -1};
+            std::array<int, COUNTER_COUNT> slots{-1, -1, -1, -1}; ///< The position of a counter in a group read.
+            int leader = -1;
+            int members = 0;
+
+            ThreadCounters() {
+#ifdef __linux__
+                constexpr uint64_t CONFIGS[COUNTER_COUNT] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                             PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+                // The first counter that opens leads the group, the cycles unless the PMU lacks them.
+                for (int i = 0; i < COUNTER_COUNT; ++i) {
+                    perf_event_attr attr{};
+                    attr.size = sizeof(attr);
+                    attr.type = PERF_TYPE_HARDWARE;
+                    attr.config = CONFIGS[i];
+                    attr.exclude_kernel = 1;
+                    attr.exclude_hv = 1;
+                    attr.read_format =
+                            PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+                    fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+                    if (fds[i] < 0) {
+                        continue;
+                    }
+                    if (leader < 0) {
+                        leader = fds[i];
+                    }
+                    slots[i] = members++;
+                }
+#endif
+            }
+
+            ~ThreadCounters() {
+#ifdef __linux__
+                // The members first, the leader last.
+                for (int i = COUNTER_COUNT - 1; i >= 0; --i) {
+                    if (fds[i] >= 0) {
+                        close(fds[i]);
+                    }
+                }
+#endif
+            }
+
+            bool available() const { return leader >= 0; }
+
+            /**
+             * @brief Read the whole group at once.
+             */
+            Reading read() const {
+                Reading reading;
+#ifdef __linux__
+                // nr, time_enabled, time_running and one value per member.
+                std::array<uint64_t, 3 + COUNTER_COUNT> buffer{};
+                const auto size = static_cast<ssize_t>((3 + members) * sizeof(uint64_t));
+                if (leader < 0 || ::read(leader, buffer.data(), size) != size ||
+                    buffer[0] != static_cast<uint64_t>(members)) {
+                    return reading;
+                }
+                reading.time_enabled = buffer[1];
+                reading.time_running = buffer[2];
+                for (int i = 0; i < COUNTER_COUNT; ++i) {
+                    if (slots[i] >= 0) {
+                        reading.counts[i] = buffer[3 + slots[i]];
+                        reading.valid[i] = true;
+                    }
+                }
+#endif
+                return reading;
+            }
+        };
+
+        ThreadCounters &threadCounters() {
+            thread_local ThreadCounters counters;
+            return counters;
+        }
+
+        void printRate(std::FILE *file, const StageStats &stats, Counter numerator, Counter denominator,
+                       double scale) {
+            if (stats.counted > 0 && stats.valid[numerator] && stats.valid[denominator] &&
+                stats.counts[denominator] > 0) {
+                std::fprintf(file, " %12.3f", scale * stats.counts[numerator] / stats.counts[denominator]);
+            } else {
+                std::fprintf(file, " %12s", "n/a");
+            }
+        }
+    } // namespace
+
+    bool enable() {
+        counting.store(true, std::memory_order_relaxed);
+        return threadCounters().available();
+    }
+
+    bool enabled() { return counting.load(std::memory_order_relaxed); }
+
+    Scope::Scope(const char *stage) : stage_(stage) {
+        if (!enabled()) {
+            return;
+        }
+        active_ = true;
+        begin_ = threadCounters().read();
+        start_ = std::chrono::steady_clock::now();
+    }
+
+    Scope::~Scope() {
+        if (!active_) {
+            return;
+        }
+        const auto seconds =
+                std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - start_)
+                        .count();
+        const auto end = threadCounters().read();
+        const auto enabled = end.time_enabled - begin_.time_enabled;
+        const auto running = end.time_running - begin_.time_running;
+
+        std::lock_guard lock(stages_mutex);
+        auto &stats = stages[stage_];
+        ++stats.calls;
+        stats.seconds += seconds;
+        stats.time_enabled += enabled;
+        stats.time_running += running;
+        // A group that never reached the PMU during the scope measured nothing, its zeros are not counts.
+        if (running == 0) {
+            return;
+        }
+        ++stats.counted;
+        // The counts of a multiplexed group are extrapolated to the whole time it was enabled.
+        const auto scale = static_cast<double>(enabled) / running;
+        for (int i = 0; i < COUNTER_COUNT; ++i) {
+            const auto valid = begin_.valid[i] && end.valid[i];
+            stats.valid[i] = stats.valid[i] && valid;
+            if (valid) {
+                stats.counts[i] += scale * static_cast<double>(end.counts[i] - begin_.counts[i]);
+            }
+        }
+    }
+
+    void report(std::FILE *file) {
+        std::lock_guard lock(stages_mutex);
+        std::fprintf(file, "%-20s %8s %12s %12s %12s %12s %12s\n", "Stage", "Calls", "Thread time", "IPC",
+                     "Cache MPKI", "Branch MPKI", "On PMU");
+        bool multiplexed = false;
+        for (const auto &[stage, stats]: stages) {
+            std::fprintf(file, "%-20.*s %8llu %11.4fs", static_cast<int>(stage.size()), stage.data(),
+                         static_cast<unsigned long long>(stats.calls), stats.seconds);
+            printRate(file, stats, INSTRUCTIONS, CYCLES, 1.0);
+            printRate(file, stats, CACHE_MISSES, INSTRUCTIONS, 1000.0);
+            printRate(file, stats, BRANCH_MISSES, INSTRUCTIONS, 1000.0);
+            if (stats.time_enabled > 0) {
+                std::fprintf(file, " %11.1f%%", 100.0 * stats.time_running / stats.time_enabled);
+                multiplexed = multiplexed || stats.time_running < stats.time_enabled;
+            } else {
+                std::fprintf(file, " %12s", "n/a");
+            }
+            std::fprintf(file, "\n");
+        }
+        if (multiplexed) {
+            std::fprintf(file, "The counters were multiplexed with other events, the counts are scaled estimates.\n");
+        }
+    }
+
+} // namespace Mandelbrot::Perf
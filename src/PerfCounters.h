@@ -0,0 +1,84 @@
+#ifndef MANDELBROTSET_SRC_PERFCOUNTERS_H
+#define MANDELBROTSET_SRC_PERFCOUNTERS_H
+
+/**
+ * @file PerfCounters.h
+ * @brief Opt-in hardware performance counters per pipeline stage.
+ *
+ * Every thread opens its own cycles, instructions, cache misses and branch misses counters with perf_event_open on
+ * its first scope. A scope adds the counter deltas and the elapsed time of its thread to the named stage, so a stage
+ * running on many threads sums up the work of all of them.
+ *
+ * The counters of a thread are one group led by the cycles, so the PMU schedules them together and their ratios come
+ * from the same time slices. If the PMU has to multiplex the group with other events, the counts are scaled by the
+ * time the group was enabled over the time it was running, and the report shows the running share. A scope during
+ * which the group never ran only adds its time, and a stage without any measured scope reports no rates.
+ *
+ * Counters are only available on Linux and only if perf_event_paranoid allows it. Otherwise the report falls back to
+ * the timing. Scopes cost a single relaxed load until counting is enabled.
+ */
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+namespace Mandelbrot::Perf {
+
+    /**
+     * @brief The hardware counters of a thread, in the order of their group. The cycles lead the group.
+     */
+    enum Counter { CYCLES, INSTRUCTIONS, CACHE_MISSES, BRANCH_MISSES, COUNTER_COUNT };
+
+    /**
+     * @brief A read of the counter group of a thread.
+     */
+    struct Reading {
+        std::array<uint64_t, COUNTER_COUNT> counts{};
+        std::array<bool, COUNTER_COUNT> valid{}; ///< Whether the counter is open and was read.
+        uint64_t time_enabled = 0; ///< The nanoseconds the group was enabled.
+        uint64_t time_running = 0; ///< The nanoseconds the group was on the PMU, less if it was multiplexed.
+    };
+
+    /**
+     * @brief Start counting. Scopes created before this call are not counted.
+     * @return True if at least one hardware counter can be opened.
+     */
+    bool enable();
+
+    /**
+     * @brief Check whether counting is enabled.
+     */
+    bool enabled();
+
+    /**
+     * @brief Print the per-stage counters: calls, thread time, IPC, misses per thousand instructions and the share of
+     *        the time the counters were on the PMU.
+     * @param file The output file.
+     */
+    void report(std::FILE *file);
+
+    /**
+     * @brief Count the lifetime of the scope on the calling thread into a stage.
+     */
+    class Scope {
+    public:
+        /**
+         * @param stage The name of the stage. It must outlive the report, a string literal in practice.
+         */
+        explicit Scope(const char *stage);
+        ~Scope();
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        const char *stage_;
+        bool active_{false};
+        Reading begin_{};
+        std::chrono::steady_clock::time_point start_{};
+    };
+
+} // namespace Mandelbrot::Perf
+
+#endif // MANDELBROTSET_SRC_PERFCOUNTERS_H
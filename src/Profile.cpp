@@ -0,0 +1,113 @@
+#include "Profile.h"
+#include <atomic>
+#include <cstdlib>
+#include <format>
+#include <fstream>
+#include <system_error>
+
+#ifdef __unix__
+#include <unistd.h>
+#endif
+
+namespace Mandelbrot {
+    namespace {
+        /**
+         * @brief A name for the temporary file of a save, unique across the processes and threads of a host.
+         */
+        std::string temporarySuffix() {
+            static std::atomic<unsigned> counter{0};
+#ifdef __unix__
+            const auto pid = static_cast<long>(getpid());
+#else
+            const long pid = 0;
+#endif
+            return std::format(".{}.{}.tmp", pid, counter.fetch_add(1, std::memory_order_relaxed));
+        }
+    } // namespace
+
+    Profile::Profile(std::filesystem::path path) : path_(std::move(path)) {
+        std::ifstream file(path_);
+        std::string line;
+        while (std::getline(file, line)) {
+            const auto separator = line.find('=');
+            if (line.empty() || line.front() == '#' || separator == std::string::npos) {
+                continue;
+            }
+            values_[line.substr(0, separator)] = line.substr(separator + 1);
+        }
+    }
+
+    std::string Profile::hostname() {
+#ifdef __unix__
+        char name[256] = {};
+        if (gethostname(name, sizeof(name) - 1) == 0 && name[0] != '\0') {
+            return name;
+        }
+#endif
+        if (const auto *name = std::getenv("COMPUTERNAME")) {
+            return name;
+        }
+        return "localhost";
+    }
+
+    std::filesystem::path Profile::defaultPath() {
+        if (const auto *path = std::getenv("MANDELBROT_PROFILE")) {
+            return path;
+        }
+        std::filesystem::path directory;
+        if (const auto *cache = std::getenv("XDG_CACHE_HOME")) {
+            directory = cache;
+        } else if (const auto *home = std::getenv("HOME")) {
+            directory = std::filesystem::path(home) / ".cache";
+        }
+        return directory / "mandelbrot" / (hostname() + ".profile");
+    }
+
+    std::optional<std::string> Profile::get(std::string_view key) const {
+        const auto it = values_.find(key);
+        if (it == values_.end()) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    Profile &Profile::set(std::string_view key, std::string value) {
+        values_[std::string(key)] = std::move(value);
+        return *this;
+    }
+
+    Profile &Profile::erase(std::string_view prefix) {
+        std::erase_if(values_, [prefix](const auto &entry) { return entry.first.starts_with(prefix); });
+        return *this;
+    }
+
+    bool Profile::save() const {
+        std::error_code error;
+        if (path_.has_parent_path()) {
+            std::filesystem::create_directories(path_.parent_path(), error);
+        }
+        // Concurrent saves write their own temporary files, and the last rename wins.
+        auto temporary = path_;
+        temporary += temporarySuffix();
+        {
+            std::ofstream file(temporary, std::ios::trunc);
+            file << "# Measured on " << hostname()
+                 << ". Delete this file or run with --recalibrate to measure again.\n";
+            for (const auto &[key, value]: values_) {
+                file << key << '=' << value << '\n';
+            }
+            if (!file) {
+                file.close();
+                std::filesystem::remove(temporary, error);
+                return false;
+            }
+        }
+        std::filesystem::rename(temporary, path_, error);
+        if (error) {
+            std::error_code ignored;
+            std::filesystem::remove(temporary, ignored);
+        }
+        return !error;
+    }
+
+} // namespace Mandelbrot
@@ -0,0 +1,63 @@
+#ifndef MANDELBROTSET_SRC_PROFILE_H
+#define MANDELBROTSET_SRC_PROFILE_H
+
+/**
+ * @file Profile.h
+ * @brief The settings measured on this host, kept between runs.
+ *
+ * A profile is a text file of key=value lines. Lines starting with '#' are comments. The file is named after the host,
+ * so a home directory shared by a fleet of nodes holds one profile per node.
+ */
+
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace Mandelbrot {
+
+    class Profile {
+    public:
+        /**
+         * @brief Load the profile at a path. A missing or unreadable file gives an empty profile.
+         */
+        explicit Profile(std::filesystem::path path = defaultPath());
+
+        /**
+         * @brief The name of this host.
+         */
+        static std::string hostname();
+
+        /**
+         * @brief The profile of this host.
+         * @return $MANDELBROT_PROFILE if set, otherwise <hostname>.profile in $XDG_CACHE_HOME/mandelbrot or
+         *         ~/.cache/mandelbrot.
+         */
+        static std::filesystem::path defaultPath();
+
+        [[nodiscard]] std::optional<std::string> get(std::string_view key) const;
+
+        Profile &set(std::string_view key, std::string value);
+
+        /**
+         * @brief Remove every key with a prefix.
+         */
+        Profile &erase(std::string_view prefix);
+
+        /**
+         * @brief Write the profile. The file is replaced atomically, so a concurrent run reads the old or the new one.
+         * @return Whether the profile was written.
+         */
+        bool save() const;
+
+        [[nodiscard]] const std::filesystem::path &getPath() const { return path_; }
+
+    private:
+        std::filesystem::path path_;
+        std::map<std::string, std::string, std::less<>> values_;
+    };
+
+} // namespace Mandelbrot
+
+#endif // MANDELBROTSET_SRC_PROFILE_H
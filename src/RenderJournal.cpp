@@ -0,0 +1,185 @@
+#include "RenderJournal.h"
+#include <algorithm>
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef __unix__
+#include <unistd.h>
+#endif
+
+namespace Mandelbrot {
+    namespace {
+        constexpr std::string_view JOURNAL_NAME = "journal.txt";
+    } // namespace
+
+    RenderJournal::RenderJournal(std::filesystem::path directory) : directory_(std::move(directory)) {}
+
+    RenderJournal::~RenderJournal() {
+        if (file_) {
+            std::fclose(file_);
+        }
+    }
+
+    bool RenderJournal::load() {
+        std::lock_guard lock(mutex_);
+        std::ifstream file(directory_ / JOURNAL_NAME);
+        if (!file) {
+            return false;
+        }
+
+        std::string line;
+        std::streamoff complete_size = 0;
+        while (std::getline(file, line)) {
+            // A last line without its newline was cut off by the kill that ended the last run. Its numbers may be
+            // cut short too, so it is dropped.
+            if (file.eof()) {
+                break;
+            }
+            complete_size = file.tellg();
+            std::istringstream stream(line);
+            std::string kind;
+            stream >> kind;
+            if (kind == "set") {
+                std::string key, value;
+                stream >> key;
+                std::getline(stream >> std::ws, value);
+                settings_[key] = value;
+                continue;
+            }
+            int keyframe = 0;
+            if (!(stream >> keyframe)) {
+                continue;
+            }
+            if (kind == "keyframe") {
+                cv::Point2d center;
+                if (stream >> center.x >> center.y) {
+                    centers_[keyframe] = center;
+                }
+            } else if (kind == "segment") {
+                segments_.insert(keyframe);
+            } else if (kind == "image") {
+                images_.insert(keyframe);
+            }
+        }
+
+        file.close();
+
+        // The dropped line is cut from the file as well. Completed by the next append, it would be read back later.
+        std::error_code error;
+        const auto path = directory_ / JOURNAL_NAME;
+        if (std::filesystem::file_size(path, error) != static_cast<uintmax_t>(complete_size) && !error) {
+            std::filesystem::resize_file(path, complete_size, error);
+        }
+        if (error) {
+            throw std::runtime_error(std::format("Cannot repair the journal in {}: {}", directory_.string(),
+                                                 error.message()));
+        }
+        file_ = std::fopen(path.string().c_str(), "a");
+        if (!file_) {
+            throw std::runtime_error(std::format("Cannot append to the journal in {}", directory_.string()));
+        }
+        return true;
+    }
+
+    void RenderJournal::create(const Settings &settings) {
+        {
+            std::lock_guard lock(mutex_);
+            std::filesystem::create_directories(directory_);
+            if (file_) {
+                std::fclose(file_);
+            }
+            file_ = std::fopen((directory_ / JOURNAL_NAME).string().c_str(), "w");
+            if (!file_) {
+                throw std::runtime_error(std::format("Cannot create the journal in {}", directory_.string()));
+            }
+            settings_ = settings;
+            centers_.clear();
+            segments_.clear();
+            images_.clear();
+        }
+        for (const auto &[key, value]: settings) {
+            append(std::format("set {} {}", key, value));
+        }
+    }
+
+    std::optional<std::string> RenderJournal::mismatch(const Settings &settings,
+                                                       std::initializer_list<std::string_view> ignore) const {
+        std::lock_guard lock(mutex_);
+        for (const auto &[key, value]: settings) {
+            if (std::ranges::find(ignore, key) != ignore.end()) {
+                continue;
+            }
+            const auto it = settings_.find(key);
+            if (it == settings_.end() || it->second != value) {
+                return key;
+            }
+        }
+        return std::nullopt;
+    }
+
+    void RenderJournal::addSetting(const std::string &key, const std::string &value) {
+        append(std::format("set {} {}", key, value));
+        std::lock_guard lock(mutex_);
+        settings_[key] = value;
+    }
+
+    void RenderJournal::addKeyframe(int keyframe, cv::Point2d center) {
+        // The shortest representation of a double reads back to the same value.
+        append(std::format("keyframe {} {} {}", keyframe, center.x, center.y));
+        std::lock_guard lock(mutex_);
+        centers_[keyframe] = center;
+    }
+
+    void RenderJournal::addSegment(int keyframe) {
+        append(std::format("segment {}", keyframe));
+        std::lock_guard lock(mutex_);
+        segments_.insert(keyframe);
+    }
+
+    void RenderJournal::addImage(int keyframe) {
+        append(std::format("image {}", keyframe));
+        std::lock_guard lock(mutex_);
+        images_.insert(keyframe);
+    }
+
+    std::optional<cv::Point2d> RenderJournal::center(int keyframe) const {
+        std::lock_guard lock(mutex_);
+        const auto it = centers_.find(keyframe);
+        if (it == centers_.end()) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    bool RenderJournal::hasSegment(int keyframe) const {
+        std::lock_guard lock(mutex_);
+        return segments_.contains(keyframe);
+    }
+
+    bool RenderJournal::hasImage(int keyframe) const {
+        std::lock_guard lock(mutex_);
+        return images_.contains(keyframe);
+    }
+
+    std::filesystem::path RenderJournal::segmentPath(int keyframe, std::string_view extension) const {
+        return directory_ / std::format("segment{:05}{}", keyframe, extension);
+    }
+
+    void RenderJournal::append(const std::string &line) {
+        std::lock_guard lock(mutex_);
+        if (!file_) {
+            throw std::runtime_error("The journal is not open");
+        }
+        if (std::fprintf(file_, "%s\n", line.c_str()) < 0 || std::fflush(file_) != 0) {
+            throw std::runtime_error(std::format("Cannot write the journal in {}", directory_.string()));
+        }
+#ifdef __unix__
+        // The line must be on disk before the work it records counts as done.
+        fsync(fileno(file_));
+#endif
+    }
+
+} // namespace Mandelbrot
@@ -0,0 +1,98 @@
+#ifndef MANDELBROTSET_SRC_RENDERJOURNAL_H
+#define MANDELBROTSET_SRC_RENDERJOURNAL_H
+
+/**
+ * @file RenderJournal.h
+ * @brief The checkpoint of a video render.
+ *
+ * The journal is an append-only text file in the checkpoint directory, next to one video file per segment. Every line
+ * is flushed to disk before the work it records is considered done, so a killed render loses at most the segments that
+ * were in flight:
+ *
+ *     set <key> <value>       A setting of the render. Resuming requires the same settings, except for the ones
+ *                             recorded during the render, e.g. the nucleus the trajectory aims at.
+ *     keyframe <k> <x> <y>    Keyframe k is rendered around x + y i.
+ *     segment <k>             The segment of keyframe k is written to its file.
+ *     image <k>               The image of keyframe k is written.
+ */
+
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+
+namespace Mandelbrot {
+
+    class RenderJournal {
+    public:
+        using Settings = std::map<std::string, std::string, std::less<>>;
+
+        /**
+         * @param directory The checkpoint directory. It is created on demand.
+         */
+        explicit RenderJournal(std::filesystem::path directory);
+        ~RenderJournal();
+
+        RenderJournal(const RenderJournal &) = delete;
+        RenderJournal &operator=(const RenderJournal &) = delete;
+
+        /**
+         * @brief Read the journal in the directory and keep appending to it.
+         * @return False if there is no journal.
+         * @note A last line without a newline is removed, since a kill may have cut it anywhere.
+         */
+        bool load();
+
+        /**
+         * @brief Start a new journal, replacing any previous one.
+         */
+        void create(const Settings &settings);
+
+        [[nodiscard]] const Settings &getSettings() const { return settings_; }
+
+        /**
+         * @brief The first setting that differs from the journal, or std::nullopt if all match.
+         * @param settings The settings of this render. Keys in ignore are not compared.
+         */
+        [[nodiscard]] std::optional<std::string> mismatch(const Settings &settings,
+                                                          std::initializer_list<std::string_view> ignore = {}) const;
+
+        /**
+         * @brief Record a setting found during the render. A later line of the same key replaces it.
+         */
+        void addSetting(const std::string &key, const std::string &value);
+
+        void addKeyframe(int keyframe, cv::Point2d center);
+        void addSegment(int keyframe);
+        void addImage(int keyframe);
+
+        [[nodiscard]] std::optional<cv::Point2d> center(int keyframe) const;
+        [[nodiscard]] bool hasSegment(int keyframe) const;
+        [[nodiscard]] bool hasImage(int keyframe) const;
+
+        /**
+         * @brief The video file of the segment of a keyframe.
+         * @param extension The extension including the dot, e.g. ".mp4".
+         */
+        [[nodiscard]] std::filesystem::path segmentPath(int keyframe, std::string_view extension) const;
+
+    private:
+        void append(const std::string &line);
+
+        std::filesystem::path directory_;
+        std::FILE *file_{nullptr};
+        mutable std::mutex mutex_;
+        Settings settings_;
+        std::map<int, cv::Point2d> centers_;
+        std::set<int> segments_;
+        std::set<int> images_;
+    };
+
+} // namespace Mandelbrot
+
+#endif // MANDELBROTSET_SRC_RENDERJOURNAL_H
@@ -0,0 +1,49 @@
+#include "RenderStats.h"
+
+namespace Mandelbrot {
+
+    RenderStats::RenderStats(int width, int height, size_t max_iterations) :
+        max_iterations(max_iterations), histogram(max_iterations + 1), tiles_x((width + TILE_SIZE - 1) / TILE_SIZE),
+        tiles_y((height + TILE_SIZE - 1) / TILE_SIZE), tile_iterations(static_cast<size_t>(tiles_x) * tiles_y) {}
+
+    RenderStats RenderStats::fromRawMatrix(const cv::Mat &matrix, size_t max_iterations) {
+        CV_Assert(matrix.type() == CV_32FC1);
+        RenderStats stats(matrix.cols, matrix.rows, max_iterations);
+
+#if ENABLE_OPENMP
+#pragma omp parallel
+#endif
+        {
+            RenderStats local(matrix.cols, matrix.rows, max_iterations);
+#if ENABLE_OPENMP
+#pragma omp for nowait
+#endif
+            for (auto y = 0; y < matrix.rows; ++y) {
+                const auto *row = matrix.ptr<float>(y);
+                for (auto x = 0; x < matrix.cols; ++x) {
+                    local.add(x, y, static_cast<size_t>(row[x]));
+                }
+            }
+#if ENABLE_OPENMP
+#pragma omp critical
+#endif
+            stats.merge(local);
+        }
+
+        return stats;
+    }
+
+    void RenderStats::merge(const RenderStats &other) {
+        CV_Assert(histogram.size() == other.histogram.size() && tile_iterations.size() == other.tile_iterations.size());
+        total_iterations += other.total_iterations;
+        interior += other.interior;
+        escaped += other.escaped;
+        for (size_t i = 0; i < histogram.size(); ++i) {
+            histogram[i] += other.histogram[i];
+        }
+        for (size_t i = 0; i < tile_iterations.size(); ++i) {
+            tile_iterations[i] += other.tile_iterations[i];
+        }
+    }
+
+} // namespace Mandelbrot
@@ -0,0 +1,79 @@
+#ifndef MANDELBROTSET_SRC_RENDERSTATS_H
+#define MANDELBROTSET_SRC_RENDERSTATS_H
+
+/**
+ * @file RenderStats.h
+ * @brief The statistics of a single render.
+ */
+
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <vector>
+
+namespace Mandelbrot {
+
+    /**
+     * @brief The amount of work behind a raw escape time matrix.
+     * @note An escape time of n costs n + 1 iterations, an interior pixel costs max_iterations.
+     */
+    struct RenderStats {
+        constexpr static int TILE_SIZE = 64; ///< The edge of a tile in pixels. Border tiles may be smaller.
+
+        size_t max_iterations = 0;
+        uint64_t total_iterations = 0;
+        uint64_t interior = 0; ///< The pixels that reached max_iterations.
+        uint64_t escaped = 0;
+        std::vector<uint64_t> histogram; ///< Pixels per escape time. The last bin counts the interior.
+        int tiles_x = 0, tiles_y = 0;
+        std::vector<uint64_t> tile_iterations; ///< The iterations per tile, row-major.
+        double wall_time = 0; ///< The elapsed time of the render in seconds.
+        double cpu_time = 0; ///< The process CPU time during the render in seconds, summed over all threads.
+
+        RenderStats() = default;
+
+        /**
+         * @brief Create empty statistics for a render.
+         * @param width The width of the image.
+         * @param height The height of the image.
+         * @param max_iterations The escape time of the interior.
+         */
+        RenderStats(int width, int height, size_t max_iterations);
+
+        /**
+         * @brief Compute the statistics from a raw matrix, for backends that do not count during the render.
+         * @param matrix The raw escape time matrix with CV_32FC1.
+         * @param max_iterations The escape time of the interior.
+         */
+        static RenderStats fromRawMatrix(const cv::Mat &matrix, size_t max_iterations);
+
+        /**
+         * @brief Count a pixel.
+         */
+        void add(int x, int y, size_t escape_time) {
+            const bool inside = escape_time >= max_iterations;
+            const auto iterations = inside ? max_iterations : escape_time + 1;
+            total_iterations += iterations;
+            interior += inside;
+            escaped += !inside;
+            ++histogram[inside ? max_iterations : escape_time];
+            tile_iterations[y / TILE_SIZE * tiles_x + x / TILE_SIZE] += iterations;
+        }
+
+        /**
+         * @brief Add the counts of another part of the same render, e.g. the share of another thread.
+         * @note The timings are not merged.
+         */
+        void merge(const RenderStats &other);
+
+        [[nodiscard]] uint64_t pixels() const { return interior + escaped; }
+        [[nodiscard]] uint64_t tileIterations(int tile_x, int tile_y) const {
+            return tile_iterations[tile_y * tiles_x + tile_x];
+        }
+        [[nodiscard]] double meanIterations() const {
+            return pixels() ? static_cast<double>(total_iterations) / pixels() : 0.0;
+        }
+    };
+
+} // namespace Mandelbrot
+
+#endif // MANDELBROTSET_SRC_RENDERSTATS_H
@@ -0,0 +1,162 @@
+#include "RuntimeMandelbrotSet.h"
+#include <algorithm>
+#include <atomic>
+#include <format>
+#include <limits>
+#include <string>
+#include "MandelbrotSet.h"
+#include "MandelbrotSetSimd.h"
+#include "Tuning.h"
+#include "Utility.h"
+#if ENABLE_CUDA
+#include "MandelbrotSetCuda.h"
+#endif
+#if ENABLE_OPENMP
+#include <omp.h>
+#endif
+
+namespace Mandelbrot {
+    namespace {
+        template<typename MandelbrotSetImpl, int THREADS = 0>
+        cv::Mat renderView(const RuntimeMandelbrotSet &view, RenderStats &stats, const Tuning *tuning) {
+            MandelbrotSetImpl mandelbrot_set;
+            mandelbrot_set.setResolution(view.getWidth(), view.getHeight())
+                    .setXRange(view.getXMin(), view.getXMax())
+                    .setYRange(view.getYMin(), view.getYMax())
+                    .setGrid(view.getGrid());
+            if constexpr (requires { mandelbrot_set.setThreadCount(THREADS); }) {
+                mandelbrot_set.setThreadCount(THREADS);
+            }
+            if constexpr (requires { mandelbrot_set.setSchedule(Schedule::Static); }) {
+                if (tuning) {
+                    // The tuned threads never exceed the OpenMP limit of the caller, e.g. its share of a ThreadBudget.
+                    auto threads = tuning->threads;
+#if ENABLE_OPENMP
+                    threads = threads > 0 ? std::min(threads, omp_get_max_threads()) : 0;
+#endif
+                    mandelbrot_set.setThreadCount(threads).setSchedule(tuning->schedule, tuning->chunk);
+                }
+            }
+            return mandelbrot_set.generateRawMatrix(stats);
+        }
+
+        template<typename MandelbrotSetImpl, int THREADS = 0>
+        cv::Mat renderWith(const RuntimeMandelbrotSet &view, RenderStats &stats) {
+            return renderView<MandelbrotSetImpl, THREADS>(view, stats, nullptr);
+        }
+
+        /**
+         * @brief Render with the tuning of the scene class of the view, or like simd8 if the class is not tuned.
+         */
+        cv::Mat renderTuned(const RuntimeMandelbrotSet &view, RenderStats &stats) {
+            const auto scene_class = classifyScene(view.getXMin(), view.getXMax(), view.getYMin(), view.getYMax());
+            const auto tuning = tuningFor(scene_class).value_or(Tuning{});
+            switch (tuning.lanes) {
+                case 1:
+                    return renderView<MandelbrotSet>(view, stats, &tuning);
+                case 4:
+                    return renderView<MandelbrotSetSimd4>(view, stats, &tuning);
+                default:
+                    return renderView<MandelbrotSetSimd8>(view, stats, &tuning);
+            }
+        }
+
+        bool always() { return true; }
+
+        constexpr Backend BACKENDS[] = {
+#if ENABLE_CUDA
+                {"cuda", "CUDA", &MandelbrotSetCuda::available, &renderWith<MandelbrotSetCuda>},
+#endif
+                {"tuned", "CPU, tuned per scene class", &hasTunings, &renderTuned},
+                {"simd8", "CPU, 8 lanes per thread", &always, &renderWith<MandelbrotSetSimd8>},
+                {"simd4", "CPU, 4 lanes per thread", &always, &renderWith<MandelbrotSetSimd4>},
+#if ENABLE_OPENMP
+                {"openmp", "CPU, OpenMP", &always, &renderWith<MandelbrotSet>},
+#endif
+                {"scalar", "CPU, single thread", &always, &renderWith<MandelbrotSet, 1>},
+        };
+
+        std::atomic<const Backend *> default_backend{nullptr};
+
+        std::string availableBackends() {
+            std::string names;
+            for (const auto &backend: backends()) {
+                if (backend.available()) {
+                    names += names.empty() ? "" : ",";
+                    names += backend.name;
+                }
+            }
+            return names;
+        }
+
+        /**
+         * @brief The best time of a render of the calibration view in seconds.
+         */
+        double calibrate(const Backend &backend) {
+            RuntimeMandelbrotSet view(RuntimeMandelbrotSet::CALIBRATION_SIZE, RuntimeMandelbrotSet::CALIBRATION_SIZE);
+            view.setBackend(backend).setCenter(-0.5, 0.0, 3.0);
+            // The first render pays for the start-up of the backend, e.g. the CUDA context and the OpenMP threads.
+            [[maybe_unused]] auto warm_up = view.generateRawMatrix();
+            auto best = std::numeric_limits<double>::infinity();
+            for (int i = 0; i < RuntimeMandelbrotSet::CALIBRATION_RUNS; ++i) {
+                const auto start = std::chrono::steady_clock::now();
+                [[maybe_unused]] auto matrix = view.generateRawMatrix();
+                best = std::min(best, TIME_DIFF(start));
+            }
+            return best;
+        }
+    } // namespace
+
+    std::span<const Backend> backends() { return BACKENDS; }
+
+    const Backend *findBackend(std::string_view name) {
+        const auto it = std::ranges::find(BACKENDS, name, &Backend::name);
+        return it == std::end(BACKENDS) ? nullptr : &*it;
+    }
+
+    const Backend &selectBackend(Profile &profile, bool recalibrate) {
+        const auto available = availableBackends();
+        if (!recalibrate && profile.get("backend.available") == available) {
+            if (const auto name = profile.get("backend")) {
+                if (const auto *backend = findBackend(*name); backend && backend->available()) {
+                    return *backend;
+                }
+            }
+        }
+
+        println(stdout, "Calibrating the backends on {}", Profile::hostname());
+        profile.erase("backend");
+        const Backend *fastest = nullptr;
+        auto fastest_time = std::numeric_limits<double>::infinity();
+        for (const auto &backend: BACKENDS) {
+            if (!backend.available()) {
+                continue;
+            }
+            const auto seconds = calibrate(backend);
+            println(stdout, "    {:<8} {:8.2f} ms", backend.name, seconds * 1000);
+            profile.set(std::format("backend.ms.{}", backend.name), std::format("{:.3f}", seconds * 1000));
+            if (seconds < fastest_time) {
+                fastest = &backend;
+                fastest_time = seconds;
+            }
+        }
+        profile.set("backend", std::string(fastest->name)).set("backend.available", available);
+        if (!profile.save()) {
+            println(stderr, "Cannot write the profile {}", profile.getPath().string());
+        }
+        return *fastest;
+    }
+
+    void RuntimeMandelbrotSet::setDefaultBackend(const Backend &backend) { default_backend = &backend; }
+
+    const Backend &RuntimeMandelbrotSet::defaultBackend() {
+        if (const auto *backend = default_backend.load()) {
+            return *backend;
+        }
+        // The scalar backend is always available.
+        const auto it = std::ranges::find_if(BACKENDS, [](const Backend &backend) { return backend.available(); });
+        default_backend = &*it;
+        return *it;
+    }
+
+} // namespace Mandelbrot
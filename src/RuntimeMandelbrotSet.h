@@ -0,0 +1,101 @@
+#ifndef MANDELBROTSET_SRC_RUNTIMEMANDELBROTSET_H
+#define MANDELBROTSET_SRC_RUNTIMEMANDELBROTSET_H
+
+/**
+ * @file RuntimeMandelbrotSet.h
+ * @brief Choose the implementation at runtime.
+ *
+ * Every implementation compiled into the binary is registered as a backend. A backend may still be unavailable at
+ * runtime, e.g. CUDA on a node without a GPU. The fastest available backend is found by a short calibration render,
+ * and the result is kept in the profile of the host, so later runs on the same host skip the calibration.
+ */
+
+#include <opencv2/core.hpp>
+#include <span>
+#include <string_view>
+#include "BaseMandelbrotSet.h"
+#include "Profile.h"
+
+namespace Mandelbrot {
+
+    class RuntimeMandelbrotSet;
+
+    /**
+     * @brief An implementation of the Mandelbrot set.
+     */
+    struct Backend {
+        std::string_view name;
+        std::string_view description;
+        bool (*available)();
+        /**
+         * @brief Render the raw matrix of a view.
+         * @param view The resolution and range.
+         * @param stats The statistics of the render.
+         */
+        cv::Mat (*render)(const RuntimeMandelbrotSet &view, RenderStats &stats);
+    };
+
+    /**
+     * @brief The backends compiled into the binary, in the order of preference without calibration.
+     */
+    std::span<const Backend> backends();
+
+    /**
+     * @brief Find a backend by name.
+     * @return The backend, or nullptr if no backend has the name.
+     */
+    const Backend *findBackend(std::string_view name);
+
+    /**
+     * @brief Select the fastest available backend.
+     * @param profile The profile of the host. The selection is read from it, or measured and written to it.
+     * @param recalibrate Measure again even if the profile has a selection.
+     * @note The selection in the profile is only used if the same backends are available as when it was measured.
+     */
+    const Backend &selectBackend(Profile &profile, bool recalibrate = false);
+
+    /**
+     * @brief The implementation that renders with a backend chosen at runtime.
+     */
+    class RuntimeMandelbrotSet : public BaseMandelbrotSet<RuntimeMandelbrotSet> {
+        using Base = BaseMandelbrotSet<RuntimeMandelbrotSet>;
+
+    public:
+        friend Base;
+
+        constexpr static int CALIBRATION_SIZE = 256;
+        constexpr static int CALIBRATION_RUNS = 3;
+
+        /**
+         * @brief Create a view with the default backend.
+         */
+        RuntimeMandelbrotSet() : backend_(&defaultBackend()) {}
+        RuntimeMandelbrotSet(const size_t width, const size_t height) :
+            Base(width, height), backend_(&defaultBackend()) {}
+
+        RuntimeMandelbrotSet &setBackend(const Backend &backend) {
+            backend_ = &backend;
+            return *this;
+        }
+
+        [[nodiscard]] const Backend &getBackend() const { return *backend_; }
+
+        /**
+         * @brief Set the backend of the views created from now on.
+         */
+        static void setDefaultBackend(const Backend &backend);
+
+        /**
+         * @brief The backend of new views. Unless set, the first available backend.
+         */
+        static const Backend &defaultBackend();
+
+    private:
+        [[nodiscard]] cv::Mat generateRawMatrixImpl(RenderStats &stats) const { return backend_->render(*this, stats); }
+
+        const Backend *backend_;
+    };
+
+} // namespace Mandelbrot
+
+#endif // MANDELBROTSET_SRC_RUNTIMEMANDELBROTSET_H
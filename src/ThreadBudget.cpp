@@ -0,0 +1,141 @@
+#include "ThreadBudget.h"
+#include <algorithm>
+#include <charconv>
+#include <thread>
+#include <vector>
+#if ENABLE_OPENMP
+#include <omp.h>
+#endif
+#ifdef __unix__
+#include <ctime>
+#endif
+
+namespace Mandelbrot {
+    namespace {
+        constexpr std::string_view STAGE_NAMES[STAGE_COUNT] = {"render", "warp", "encode", "imageWrite"};
+
+        constexpr size_t index(Stage stage) { return static_cast<size_t>(stage); }
+
+        int64_t threadCpuNs() {
+#ifdef __unix__
+            timespec time{};
+            clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+            return int64_t{time.tv_sec} * 1'000'000'000 + time.tv_nsec;
+#else
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now().time_since_epoch())
+                    .count();
+#endif
+        }
+    } // namespace
+
+    std::string_view stageName(Stage stage) { return STAGE_NAMES[index(stage)]; }
+
+    ThreadBudget::ThreadBudget() : ThreadBudget(std::max(1u, std::thread::hardware_concurrency())) {}
+
+    ThreadBudget::ThreadBudget(unsigned int total) {
+        const auto image_write = std::max(1u, total / 8);
+        const auto rest = total > image_write ? total - image_write : 1u;
+        const auto render = std::max(1u, rest / 2);
+        const auto warp = std::max(1u, rest > render ? rest - render : 1u);
+        *this = ThreadBudget(render, warp, image_write);
+    }
+
+    ThreadBudget::ThreadBudget(unsigned int render, unsigned int warp, unsigned int image_write) {
+        shares_[index(Stage::Render)] = std::max(1u, render);
+        shares_[index(Stage::Warp)] = std::max(1u, warp);
+        shares_[index(Stage::Encode)] = 1;
+        shares_[index(Stage::ImageWrite)] = std::max(1u, image_write);
+    }
+
+    ThreadBudget::ThreadBudget(const ThreadBudget &other) : shares_(other.shares_) {}
+
+    ThreadBudget &ThreadBudget::operator=(const ThreadBudget &other) {
+        shares_ = other.shares_;
+        start();
+        return *this;
+    }
+
+    std::optional<ThreadBudget> ThreadBudget::parse(std::string_view text) {
+        std::vector<unsigned int> counts;
+        while (true) {
+            const auto colon = text.find(':');
+            const auto part = text.substr(0, colon);
+            unsigned int count = 0;
+            const auto [end, error] = std::from_chars(part.data(), part.data() + part.size(), count);
+            if (part.empty() || error != std::errc{} || end != part.data() + part.size() || count == 0) {
+                return std::nullopt;
+            }
+            counts.push_back(count);
+            if (colon == std::string_view::npos) {
+                break;
+            }
+            text.remove_prefix(colon + 1);
+        }
+
+        if (counts.size() == 1) {
+            return ThreadBudget(counts[0]);
+        }
+        if (counts.size() == 3) {
+            return ThreadBudget(counts[0], counts[1], counts[2]);
+        }
+        return std::nullopt;
+    }
+
+    unsigned int ThreadBudget::total() const {
+        return share(Stage::Render) + share(Stage::Warp) + share(Stage::ImageWrite);
+    }
+
+    unsigned int ThreadBudget::share(Stage stage) const { return shares_[index(stage)]; }
+
+    void ThreadBudget::limitOpenMP([[maybe_unused]] Stage stage, [[maybe_unused]] unsigned int parts) const {
+#if ENABLE_OPENMP
+        omp_set_num_threads(static_cast<int>(std::max(1u, share(stage) / std::max(1u, parts))));
+#endif
+    }
+
+    void ThreadBudget::start() {
+        for (auto &busy: busy_ns_) {
+            busy = 0;
+        }
+        start_ = std::chrono::steady_clock::now();
+    }
+
+    void ThreadBudget::record(Stage stage, std::chrono::steady_clock::duration thread_time) const {
+        busy_ns_[index(stage)].fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(thread_time).count(),
+                                         std::memory_order_relaxed);
+    }
+
+    void ThreadBudget::report(std::FILE *file) const {
+        const auto wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+        std::fprintf(file, "Thread budget: %u threads over %.2fs\n", total(), wall);
+        std::fprintf(file, "%-20s %8s %12s %12s\n", "Stage", "Threads", "Thread time", "Utilization");
+        for (int i = 0; i < STAGE_COUNT; ++i) {
+            const auto name = STAGE_NAMES[i];
+            const auto seconds = busy_ns_[i].load(std::memory_order_relaxed) * 1e-9;
+            const auto capacity = shares_[i] * wall;
+            std::fprintf(file, "%-20.*s %8u %11.4fs %11.1f%%\n", static_cast<int>(name.size()), name.data(), shares_[i],
+                         seconds, capacity > 0 ? 100.0 * seconds / capacity : 0.0);
+        }
+    }
+
+    ThreadBudget::Scope::Scope(const ThreadBudget &budget, Stage stage) :
+        budget_(budget), stage_(stage), start_(std::chrono::steady_clock::now()) {}
+
+    ThreadBudget::Scope::~Scope() { budget_.record(stage_, std::chrono::steady_clock::now() - start_); }
+
+    ThreadBudget::TeamScope::TeamScope(const ThreadBudget &budget, Stage stage) :
+        budget_(budget), stage_(stage), start_(teamCpuTime()) {}
+
+    ThreadBudget::TeamScope::~TeamScope() { budget_.record(stage_, teamCpuTime() - start_); }
+
+    std::chrono::nanoseconds ThreadBudget::TeamScope::teamCpuTime() {
+        int64_t total = 0;
+#if ENABLE_OPENMP
+#pragma omp parallel reduction(+ : total)
+#endif
+        total += threadCpuNs();
+        return std::chrono::nanoseconds(total);
+    }
+
+} // namespace Mandelbrot
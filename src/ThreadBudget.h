@@ -0,0 +1,157 @@
+#ifndef MANDELBROTSET_SRC_THREADBUDGET_H
+#define MANDELBROTSET_SRC_THREADBUDGET_H
+
+/**
+ * @file ThreadBudget.h
+ * @brief Split the cores of the host between the stages of the video pipeline.
+ *
+ * The video pipeline runs three stages at once: the keyframe render on the main thread and its OpenMP team, the warp
+ * of the previous segment on the compute pool, and the keyframe writes on the IO pool. The encode runs on one thread
+ * of the compute pool once the warp of its segment is done, so it shares the threads of the warp.
+ *
+ * The budget hands every stage a share of the threads, such that the stages together never run more threads than the
+ * budget. Every stage adds its busy thread time, so that the report shows how much of its share a stage has used. The
+ * pool stages count the wall time of their tasks, one thread each. The render runs on OpenMP teams, whose threads may
+ * idle at the end of an uneven render, so it counts the CPU time that its teams actually spent.
+ */
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string_view>
+
+namespace Mandelbrot {
+
+    /**
+     * @brief A stage of the video pipeline.
+     */
+    enum class Stage {
+        Render, ///< The keyframe render, colorize and zoom target search.
+        Warp, ///< The intermediate frames.
+        Encode, ///< The frame sink.
+        ImageWrite, ///< The keyframe images.
+    };
+
+    constexpr int STAGE_COUNT = 4;
+
+    std::string_view stageName(Stage stage);
+
+    /**
+     * @brief The threads of every stage, and the thread time they have used.
+     */
+    class ThreadBudget {
+    public:
+        /**
+         * @brief Split all hardware threads.
+         */
+        ThreadBudget();
+
+        /**
+         * @brief Split a number of threads. One eighth writes the images, and the render and the warp share the rest.
+         * @note Every stage gets at least one thread, so a budget below three is exceeded.
+         */
+        explicit ThreadBudget(unsigned int total);
+
+        /**
+         * @brief Set the share of every stage.
+         */
+        ThreadBudget(unsigned int render, unsigned int warp, unsigned int image_write);
+
+        // Only the shares are copied. The thread time starts at zero.
+        ThreadBudget(const ThreadBudget &other);
+        ThreadBudget &operator=(const ThreadBudget &other);
+
+        /**
+         * @brief Parse a budget of the form "<total>" or "<render>:<warp>:<write>".
+         * @return The budget, or std::nullopt if the string is invalid.
+         */
+        static std::optional<ThreadBudget> parse(std::string_view text);
+
+        /**
+         * @brief The number of threads of all stages.
+         */
+        [[nodiscard]] unsigned int total() const;
+
+        /**
+         * @brief The number of threads of a stage. The encode always has one thread, taken from the warp.
+         */
+        [[nodiscard]] unsigned int share(Stage stage) const;
+
+        /**
+         * @brief Limit the OpenMP teams started by the calling thread to the share of a stage.
+         * @param parts The teams that run at once and split the share, at least one thread each.
+         */
+        void limitOpenMP(Stage stage, unsigned int parts = 1) const;
+
+        /**
+         * @brief Reset the thread time and start the clock of the report.
+         */
+        void start();
+
+        /**
+         * @brief Add busy thread time to a stage. Safe to call from any thread.
+         */
+        void record(Stage stage, std::chrono::steady_clock::duration thread_time) const;
+
+        /**
+         * @brief Print the share, thread time and utilization of every stage since start().
+         * @param file The output file.
+         */
+        void report(std::FILE *file) const;
+
+        /**
+         * @brief Count the lifetime of the scope as busy time of a stage, for the calling thread only.
+         */
+        class Scope {
+        public:
+            Scope(const ThreadBudget &budget, Stage stage);
+            ~Scope();
+
+            Scope(const Scope &) = delete;
+            Scope &operator=(const Scope &) = delete;
+
+        private:
+            const ThreadBudget &budget_;
+            Stage stage_;
+            std::chrono::steady_clock::time_point start_;
+        };
+
+        /**
+         * @brief Count the CPU time that the calling thread and its OpenMP team spend during the scope as busy time
+         *        of a stage.
+         * @note The CPU time of every thread of the team is read in a parallel region at both ends of the scope. The
+         *       team keeps its threads between the regions as long as its size does not change, so the parallel
+         *       regions of the scope have to run on the team set by limitOpenMP. Threads that wait in a barrier may
+         *       still spin for a while, which counts, as it keeps the core from other work as well.
+         */
+        class TeamScope {
+        public:
+            TeamScope(const ThreadBudget &budget, Stage stage);
+            ~TeamScope();
+
+            TeamScope(const TeamScope &) = delete;
+            TeamScope &operator=(const TeamScope &) = delete;
+
+        private:
+            /**
+             * @brief The CPU time of the calling thread and the threads of its team so far.
+             */
+            static std::chrono::nanoseconds teamCpuTime();
+
+            const ThreadBudget &budget_;
+            Stage stage_;
+            std::chrono::nanoseconds start_;
+        };
+
+    private:
+        std::array<unsigned int, STAGE_COUNT> shares_{};
+        mutable std::array<std::atomic<int64_t>, STAGE_COUNT> busy_ns_{};
+        std::chrono::steady_clock::time_point start_{std::chrono::steady_clock::now()};
+    };
+
+} // namespace Mandelbrot
+
+#endif // MANDELBROTSET_SRC_THREADBUDGET_H
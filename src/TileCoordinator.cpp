@@ -0,0 +1,301 @@
+#include "TileCoordinator.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <format>
+#include <stdexcept>
+#include <vector>
+#include "Utility.h"
+
+#ifdef __unix__
+#include <cerrno>
+#include <csignal>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace Mandelbrot {
+#ifdef __unix__
+    namespace {
+        using Clock = std::chrono::steady_clock;
+
+        /**
+         * @brief The coordinator asks a worker for a tile.
+         */
+        struct TileRequest {
+            int32_t tile, x, y, width, height;
+        };
+
+        /**
+         * @brief A worker answers a tile. The width * height floats of the tile follow.
+         */
+        struct TileResponse {
+            int32_t tile, width, height;
+        };
+
+        struct Lease {
+            int tile;
+            Clock::time_point deadline;
+            bool expired;
+        };
+
+        struct Worker {
+            pid_t pid;
+            int fd;
+            std::vector<Lease> leases{};
+            int rendered = 0;
+            bool alive = true;
+        };
+
+        bool sendAll(int fd, const void *data, size_t size) {
+            const auto *bytes = static_cast<const char *>(data);
+            while (size > 0) {
+                const auto sent = send(fd, bytes, size, MSG_NOSIGNAL);
+                if (sent < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (sent <= 0) {
+                    return false;
+                }
+                bytes += sent;
+                size -= sent;
+            }
+            return true;
+        }
+
+        bool receiveAll(int fd, void *data, size_t size) {
+            auto *bytes = static_cast<char *>(data);
+            while (size > 0) {
+                const auto received = recv(fd, bytes, size, 0);
+                if (received < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (received <= 0) {
+                    return false;
+                }
+                bytes += received;
+                size -= received;
+            }
+            return true;
+        }
+
+        template<typename Renderer>
+        [[noreturn]] void runWorker(const Renderer &render_tile, int fd) {
+            TileRequest request{};
+            while (receiveAll(fd, &request, sizeof(request))) {
+                const cv::Mat raw = render_tile(cv::Rect(request.x, request.y, request.width, request.height));
+                const TileResponse response{request.tile, raw.cols, raw.rows};
+                if (!sendAll(fd, &response, sizeof(response)) ||
+                    !sendAll(fd, raw.ptr<float>(), raw.total() * sizeof(float))) {
+                    break;
+                }
+            }
+            // Skip the atexit handlers inherited from the coordinator, e.g. the trace dump.
+            _exit(0);
+        }
+    } // namespace
+
+    cv::Mat TileCoordinator::renderTiles(int width, int height, const TileRenderer &render_tile) const {
+        cv::Mat raw(height, width, CV_32FC1);
+
+        std::vector<cv::Rect> tiles;
+        for (auto y = 0; y < height; y += tile_size_) {
+            for (auto x = 0; x < width; x += tile_size_) {
+                tiles.emplace_back(x, y, std::min(tile_size_, width - x), std::min(tile_size_, height - y));
+            }
+        }
+        std::deque<int> pending;
+        for (int i = 0; i < static_cast<int>(tiles.size()); ++i) {
+            pending.push_back(i);
+        }
+        std::vector<bool> done(tiles.size(), false);
+        std::vector<int> copies(tiles.size(), 0); // The outstanding leases of every tile.
+        auto remaining = tiles.size();
+        int requeued = 0, stolen = 0;
+
+        std::vector<Worker> workers;
+        // A worker holds no state worth keeping, so it is killed on every exit path, even in the middle of a tile.
+        ScopeGuard guard([&workers] {
+            for (const auto &worker: workers) {
+                close(worker.fd);
+                kill(worker.pid, SIGKILL);
+                waitpid(worker.pid, nullptr, 0);
+            }
+        });
+        for (int i = 0; i < worker_count_; ++i) {
+            int fds[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0) {
+                throw std::runtime_error(std::format("Cannot create a worker socket: {}", std::strerror(errno)));
+            }
+            const auto pid = fork();
+            if (pid < 0) {
+                close(fds[0]);
+                close(fds[1]);
+                throw std::runtime_error(std::format("Cannot fork a worker: {}", std::strerror(errno)));
+            }
+            if (pid == 0) {
+                close(fds[0]);
+                for (const auto &worker: workers) {
+                    close(worker.fd);
+                }
+                runWorker(render_tile, fds[1]);
+            }
+            close(fds[1]);
+            workers.push_back({pid, fds[0]});
+        }
+
+        auto retire = [&](Worker &worker) {
+            worker.alive = false;
+            for (const auto &lease: worker.leases) {
+                // The tile of an expired lease was re-queued when it expired.
+                if (--copies[lease.tile] == 0 && !done[lease.tile] && !lease.expired) {
+                    pending.push_front(lease.tile);
+                    ++requeued;
+                }
+            }
+            worker.leases.clear();
+        };
+
+        auto nextTile = [&](const Worker &thief) {
+            while (!pending.empty()) {
+                const auto tile = pending.front();
+                pending.pop_front();
+                if (!done[tile]) {
+                    return tile;
+                }
+            }
+            // Nothing fresh is left. Steal a copy of the oldest lease that only one other worker is working on.
+            const Lease *oldest = nullptr;
+            for (const auto &worker: workers) {
+                if (&worker == &thief) {
+                    continue;
+                }
+                for (const auto &lease: worker.leases) {
+                    if (!done[lease.tile] && copies[lease.tile] == 1 &&
+                        (!oldest || lease.deadline < oldest->deadline)) {
+                        oldest = &lease;
+                    }
+                }
+            }
+            if (!oldest) {
+                return -1;
+            }
+            ++stolen;
+            return oldest->tile;
+        };
+
+        cv::Mat buffer;
+        auto receive = [&](Worker &worker) {
+            TileResponse response{};
+            if (!receiveAll(worker.fd, &response, sizeof(response)) || response.tile < 0 ||
+                response.tile >= static_cast<int>(tiles.size())) {
+                return false;
+            }
+            const auto &rect = tiles[response.tile];
+            if (response.width != rect.width || response.height != rect.height) {
+                return false;
+            }
+            buffer.create(rect.height, rect.width, CV_32FC1);
+            if (!receiveAll(worker.fd, buffer.ptr<float>(), buffer.total() * sizeof(float))) {
+                return false;
+            }
+
+            const auto lease = std::ranges::find(worker.leases, response.tile, &Lease::tile);
+            if (lease != worker.leases.end()) {
+                worker.leases.erase(lease);
+                --copies[response.tile];
+            }
+            // The first answer of a tile wins.
+            if (!done[response.tile]) {
+                done[response.tile] = true;
+                --remaining;
+                ++worker.rendered;
+                cv::Mat target = raw(rect);
+                buffer.copyTo(target);
+            }
+            return true;
+        };
+
+        const auto timeout = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(lease_timeout_));
+        std::vector<pollfd> fds;
+        std::vector<Worker *> owners;
+        while (remaining > 0) {
+            for (auto &worker: workers) {
+                while (worker.alive && worker.leases.size() < LEASES_PER_WORKER) {
+                    const auto tile = nextTile(worker);
+                    if (tile < 0) {
+                        break;
+                    }
+                    const auto &rect = tiles[tile];
+                    const TileRequest request{tile, rect.x, rect.y, rect.width, rect.height};
+                    if (!sendAll(worker.fd, &request, sizeof(request))) {
+                        pending.push_front(tile);
+                        retire(worker);
+                        break;
+                    }
+                    worker.leases.push_back({tile, Clock::now() + timeout, false});
+                    ++copies[tile];
+                }
+            }
+
+            fds.clear();
+            owners.clear();
+            auto next_deadline = Clock::time_point::max();
+            for (auto &worker: workers) {
+                if (!worker.alive) {
+                    continue;
+                }
+                fds.push_back({worker.fd, POLLIN, 0});
+                owners.push_back(&worker);
+                for (const auto &lease: worker.leases) {
+                    if (!lease.expired) {
+                        next_deadline = std::min(next_deadline, lease.deadline);
+                    }
+                }
+            }
+            if (fds.empty()) {
+                throw std::runtime_error("All tile workers died");
+            }
+
+            // Wake up at the next lease deadline at the latest.
+            const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next_deadline - Clock::now());
+            const auto wait_ms = static_cast<int>(std::clamp<int64_t>(wait.count(), 0, 1000));
+            if (poll(fds.data(), fds.size(), wait_ms) < 0 && errno != EINTR) {
+                throw std::runtime_error(std::format("Cannot poll the tile workers: {}", std::strerror(errno)));
+            }
+            for (size_t i = 0; i < fds.size(); ++i) {
+                if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                    if (!receive(*owners[i])) {
+                        println(stderr, "Tile worker {} died, re-queueing its tiles", owners[i]->pid);
+                        retire(*owners[i]);
+                    }
+                }
+            }
+
+            // An expired lease stays with its worker, whose answer is still accepted, but the tile is handed out again.
+            const auto now = Clock::now();
+            for (auto &worker: workers) {
+                for (auto &lease: worker.leases) {
+                    if (!lease.expired && lease.deadline < now && !done[lease.tile]) {
+                        lease.expired = true;
+                        pending.push_back(lease.tile);
+                        ++requeued;
+                    }
+                }
+            }
+        }
+
+        println(stdout, "Tiles: {} on {} workers, {} re-queued, {} stolen", tiles.size(), workers.size(), requeued,
+                stolen);
+        return raw;
+    }
+#else
+    cv::Mat TileCoordinator::renderTiles(int, int, const TileRenderer &) const {
+        throw std::runtime_error("Tile workers are only available on POSIX systems");
+    }
+#endif
+
+} // namespace Mandelbrot
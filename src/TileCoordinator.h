@@ -0,0 +1,82 @@
+#ifndef MANDELBROTSET_SRC_TILECOORDINATOR_H
+#define MANDELBROTSET_SRC_TILECOORDINATOR_H
+
+/**
+ * @file TileCoordinator.h
+ * @brief Render an image across forked worker processes.
+ *
+ * The coordinator splits the image into tiles and leases them to the workers over a socket each. A worker renders a
+ * tile with its own copy of the Mandelbrot set and sends back the raw escape counts. A lease that is not answered in
+ * time is handed out again, and once no fresh tile is left, idle workers steal a copy of the oldest outstanding
+ * lease. The first answer of a tile wins. If a worker dies, its leases go back to the queue.
+ *
+ * The messages are fixed-size headers followed by the floats of a tile, so the same protocol works over any stream
+ * socket. Workers are only available on POSIX systems.
+ */
+
+#include <functional>
+#include <opencv2/core.hpp>
+
+namespace Mandelbrot {
+
+    class TileCoordinator {
+    public:
+#ifdef __unix__
+        constexpr static bool AVAILABLE = true;
+#else
+        constexpr static bool AVAILABLE = false;
+#endif
+        constexpr static int TILE_SIZE = 256;
+        constexpr static double LEASE_TIMEOUT = 10.0;
+        // The leases a worker holds at once, so that it never waits for the coordinator between two tiles.
+        constexpr static int LEASES_PER_WORKER = 2;
+
+        TileCoordinator &setWorkerCount(int worker_count) {
+            worker_count_ = worker_count;
+            return *this;
+        }
+
+        TileCoordinator &setTileSize(int tile_size) {
+            tile_size_ = tile_size;
+            return *this;
+        }
+
+        TileCoordinator &setLeaseTimeout(double seconds) {
+            lease_timeout_ = seconds;
+            return *this;
+        }
+
+        /**
+         * @brief Render the raw matrix of a view.
+         * @param mandelbrot_set The view. The workers are forked with a copy of it.
+         * @return The raw escape time matrix with CV_32FC1.
+         * @throw std::runtime_error If the workers cannot be started or all of them died.
+         * @note Fork before starting other threads. Only the calling thread exists in the workers.
+         */
+        template<typename MandelbrotSetImpl>
+        [[nodiscard]] cv::Mat render(const MandelbrotSetImpl &mandelbrot_set) const {
+            const auto width = static_cast<int>(mandelbrot_set.getWidth());
+            const auto height = static_cast<int>(mandelbrot_set.getHeight());
+            return renderTiles(width, height, [&mandelbrot_set](const cv::Rect &rect) {
+                auto part = mandelbrot_set.region(rect);
+                // The processes are the parallelism, so every worker renders on a single thread.
+                if constexpr (requires { part.setThreadCount(1); }) {
+                    part.setThreadCount(1);
+                }
+                return part.generateRawMatrix();
+            });
+        }
+
+    private:
+        using TileRenderer = std::function<cv::Mat(const cv::Rect &)>;
+
+        [[nodiscard]] cv::Mat renderTiles(int width, int height, const TileRenderer &render_tile) const;
+
+        int worker_count_{4};
+        int tile_size_{TILE_SIZE};
+        double lease_timeout_{LEASE_TIMEOUT};
+    };
+
+} // namespace Mandelbrot
+
+#endif // MANDELBROTSET_SRC_TILECOORDINATOR_H
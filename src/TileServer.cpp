@@ -0,0 +1,380 @@
+#include "TileServer.h"
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <format>
+#include <opencv2/imgcodecs.hpp>
+#include <stdexcept>
+#include <stdexec/execution.hpp>
+#include <string_view>
+#include "MandelbrotSet.h"
+#include "Numa.h"
+#include "PerfCounters.h"
+#include "Utility.h"
+
+#ifdef __unix__
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace Mandelbrot {
+
+    TileCache::Data TileCache::get(const TileKey &key) {
+        const auto it = index_.find(key);
+        if (it == index_.end()) {
+            return nullptr;
+        }
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return it->second->second;
+    }
+
+    void TileCache::put(const TileKey &key, Data data) {
+        if (const auto it = index_.find(key); it != index_.end()) {
+            bytes_ -= it->second->second->size();
+            entries_.erase(it->second);
+            index_.erase(it);
+        }
+        bytes_ += data->size();
+        entries_.emplace_front(key, std::move(data));
+        index_[key] = entries_.begin();
+        while (bytes_ > capacity_ && entries_.size() > 1) {
+            const auto &[oldest, oldest_data] = entries_.back();
+            bytes_ -= oldest_data->size();
+            index_.erase(oldest);
+            entries_.pop_back();
+        }
+    }
+
+    void LatencyStats::add(double milliseconds) {
+        if (samples_.size() < WINDOW) {
+            samples_.push_back(milliseconds);
+        } else {
+            samples_[count_ % WINDOW] = milliseconds;
+        }
+        ++count_;
+    }
+
+    double LatencyStats::percentile(double p) const {
+        if (samples_.empty()) {
+            return 0.0;
+        }
+        auto sorted = samples_;
+        const auto rank = static_cast<size_t>(std::ceil(p * sorted.size())) - (p > 0);
+        std::ranges::nth_element(sorted, sorted.begin() + rank);
+        return sorted[rank];
+    }
+
+#ifdef __unix__
+    namespace {
+        // A tile never changes, but the stats and the errors must not be served from a cache.
+        constexpr std::string_view CACHE_TILE = "max-age=86400";
+        constexpr std::string_view CACHE_NONE = "no-store";
+
+        // A client has this long to send its request line, and to take every chunk of the answer.
+        constexpr auto REQUEST_TIMEOUT = std::chrono::seconds(5);
+        constexpr size_t MAX_REQUEST_SIZE = 8192;
+        // The pause of accept after running out of descriptors or memory, so the loop does not spin meanwhile.
+        constexpr auto ACCEPT_BACKOFF = std::chrono::milliseconds(100);
+
+        /**
+         * @brief An accepted connection whose request line is still arriving.
+         */
+        struct Connection {
+            int fd;
+            std::chrono::steady_clock::time_point start;
+            std::string request;
+        };
+
+        /**
+         * @brief Whether accept failed because the process or the system is out of resources, which lasts a while.
+         */
+        bool outOfResources(int error) {
+            return error == EMFILE || error == ENFILE || error == ENOBUFS || error == ENOMEM;
+        }
+
+        void respond(int fd, std::string_view status, std::string_view type, std::string_view cache_control,
+                     const void *body, size_t size) {
+            const auto header = std::format("HTTP/1.1 {}\r\nContent-Type: {}\r\nContent-Length: {}\r\n"
+                                            "Cache-Control: {}\r\nConnection: close\r\n\r\n",
+                                            status, type, size, cache_control);
+            // A client that hung up is not an error of the server.
+            [[maybe_unused]] auto sent = send(fd, header.data(), header.size(), MSG_NOSIGNAL);
+            const auto *bytes = static_cast<const char *>(body);
+            while (size > 0) {
+                const auto written = send(fd, bytes, size, MSG_NOSIGNAL);
+                if (written <= 0) {
+                    break;
+                }
+                bytes += written;
+                size -= written;
+            }
+            close(fd);
+        }
+
+        void respond(int fd, std::string_view status, std::string_view body) {
+            respond(fd, status, "text/plain", CACHE_NONE, body.data(), body.size());
+        }
+    } // namespace
+
+    void TileServer::run(int port) {
+        const auto listener = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listener < 0) {
+            throw std::runtime_error(std::format("Cannot open a socket: {}", std::strerror(errno)));
+        }
+        const int reuse = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(port));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+            listen(listener, SOMAXCONN) != 0) {
+            const auto error = errno;
+            close(listener);
+            throw std::runtime_error(std::format("Cannot listen on port {}: {}", port, std::strerror(error)));
+        }
+        println(stdout, "Serving tiles on http://127.0.0.1:{}/tiles/{{z}}/{{x}}/{{y}}.png", port);
+        println(stdout, "Render threads: {}", worker_count_);
+        if (Numa::pinning()) {
+            for (auto [pool, count]: {std::pair{&compute_pool_, worker_count_}, std::pair{&io_pool_, io_count_}}) {
+                onEveryThread(pool->get_scheduler(), count, [count](size_t i) {
+                    Numa::pinCurrentThread(Numa::threadCpus(i, count));
+                });
+            }
+        }
+
+        // This thread accepts the connections and reads their request lines, all with poll, so a slow or idle
+        // client only costs a descriptor. A complete request goes to the IO pool.
+        std::vector<Connection> connections;
+        std::vector<pollfd> fds;
+        auto accept_after = std::chrono::steady_clock::time_point::min();
+        char buffer[1024];
+        while (true) {
+            const auto now = std::chrono::steady_clock::now();
+            auto wake_up = now + REQUEST_TIMEOUT;
+            fds.clear();
+            const bool accepting = now >= accept_after;
+            fds.push_back({listener, static_cast<short>(accepting ? POLLIN : 0), 0});
+            if (!accepting) {
+                wake_up = std::min(wake_up, accept_after);
+            }
+            for (const auto &connection: connections) {
+                fds.push_back({connection.fd, POLLIN, 0});
+                wake_up = std::min(wake_up, connection.start + REQUEST_TIMEOUT);
+            }
+            const auto wait = std::chrono::ceil<std::chrono::milliseconds>(wake_up - now).count();
+            if (poll(fds.data(), fds.size(), static_cast<int>(std::max<int64_t>(wait, 0))) < 0 && errno != EINTR) {
+                throw std::runtime_error(std::format("Cannot poll the connections: {}", std::strerror(errno)));
+            }
+
+            // The connections are read first, since the accepted ones are appended.
+            for (size_t i = connections.size(); i-- > 0;) {
+                auto &connection = connections[i];
+                bool done = false, failed = false;
+                if (fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)) {
+                    const auto received = recv(connection.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+                    if (received > 0) {
+                        connection.request.append(buffer, received);
+                        // Only the request line matters. The rest of the header is ignored.
+                        done = connection.request.find("\r\n") != std::string::npos ||
+                               connection.request.size() >= MAX_REQUEST_SIZE;
+                    } else if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                        failed = true;
+                    }
+                }
+                if (!done && !failed && std::chrono::steady_clock::now() - connection.start >= REQUEST_TIMEOUT) {
+                    failed = true;
+                }
+                if (done) {
+                    scope_.spawn(ex::starts_on(io_pool_.get_scheduler(),
+                                               ex::just() | ex::then([this, connection = std::move(connection)] {
+                                                   handle(connection.fd, connection.request, connection.start);
+                                               })));
+                } else if (failed) {
+                    close(connection.fd);
+                }
+                if (done || failed) {
+                    if (i + 1 != connections.size()) {
+                        connections[i] = std::move(connections.back());
+                    }
+                    connections.pop_back();
+                }
+            }
+
+            if (accepting && (fds[0].revents & POLLIN)) {
+                const auto fd = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+                if (fd >= 0) {
+                    // A client that does not take the answer only holds up the sending thread for so long.
+                    const timeval timeout{static_cast<time_t>(REQUEST_TIMEOUT.count()), 0};
+                    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+                    connections.push_back({fd, std::chrono::steady_clock::now(), {}});
+                } else if (outOfResources(errno)) {
+                    println(stderr, "Cannot accept a connection: {}. Pausing for {} ms", std::strerror(errno),
+                            ACCEPT_BACKOFF.count());
+                    accept_after = std::chrono::steady_clock::now() + ACCEPT_BACKOFF;
+                } else if (errno != EINTR && errno != EAGAIN && errno != ECONNABORTED) {
+                    println(stderr, "Cannot accept a connection: {}", std::strerror(errno));
+                }
+            }
+        }
+    }
+
+    void TileServer::handle(int fd, const std::string &request, std::chrono::steady_clock::time_point start) {
+        std::string_view line(request.data(), std::min(request.find("\r\n"), request.size()));
+
+        if (!line.starts_with("GET ")) {
+            respond(fd, "405 Method Not Allowed", "Only GET is supported\n");
+            return;
+        }
+        line.remove_prefix(4);
+        auto path = line.substr(0, line.find(' '));
+        std::string_view query;
+        if (const auto mark = path.find('?'); mark != std::string_view::npos) {
+            query = path.substr(mark + 1);
+            path = path.substr(0, mark);
+        }
+
+        if (path == "/stats") {
+            const auto json = statsJson();
+            respond(fd, "200 OK", "application/json", CACHE_NONE, json.data(), json.size());
+            return;
+        }
+
+        TileKey key{};
+        char extension[8] = {};
+        if (std::sscanf(std::string(path).c_str(), "/tiles/%d/%d/%d.%7s", &key.z, &key.x, &key.y, extension) != 4 ||
+            std::string_view(extension) != "png" || key.z < 0 || key.z > MAX_ZOOM || key.x < 0 || key.y < 0 ||
+            key.x >= (int64_t{1} << key.z) || key.y >= (int64_t{1} << key.z)) {
+            respond(fd, "404 Not Found", "No such tile\n");
+            return;
+        }
+        requestTile(fd, key, query.find("prefetch=1") == std::string_view::npos, start);
+    }
+
+    void TileServer::requestTile(int fd, const TileKey &key, bool visible,
+                                 std::chrono::steady_clock::time_point start) {
+        std::unique_lock lock(mutex_);
+        if (auto data = cache_.get(key)) {
+            ++hits_;
+            record({fd, start, visible});
+            lock.unlock();
+            respond(fd, "200 OK", "image/png", CACHE_TILE, data->data(), data->size());
+            return;
+        }
+
+        ++misses_;
+        auto [it, inserted] = in_flight_.try_emplace(key);
+        auto &in_flight = it->second;
+        in_flight.waiters.push_back({fd, start, visible});
+        if (!inserted) {
+            ++coalesced_;
+        }
+        // A render is queued for a new tile, and once more when a queued prefetch becomes visible. The stale entry is
+        // skipped when it comes up.
+        if (inserted || (visible && !in_flight.visible && !in_flight.started)) {
+            in_flight.visible = in_flight.visible || visible;
+            queue_.push({in_flight.visible, sequence_++, key});
+            lock.unlock();
+            scope_.spawn(ex::starts_on(compute_pool_.get_scheduler(),
+                                       ex::just() | ex::then([this] { renderNext(); })));
+        }
+    }
+
+    void TileServer::renderNext() {
+        TileKey key{};
+        {
+            std::lock_guard lock(mutex_);
+            while (true) {
+                if (queue_.empty()) {
+                    return;
+                }
+                key = queue_.top().key;
+                queue_.pop();
+                const auto it = in_flight_.find(key);
+                if (it != in_flight_.end() && !it->second.started) {
+                    it->second.started = true;
+                    break;
+                }
+            }
+        }
+
+        TileCache::Data data;
+        std::string error;
+        try {
+            data = std::make_shared<const std::vector<uchar>>(renderTile(key));
+        } catch (const std::exception &e) {
+            error = e.what();
+        }
+
+        // The waiters are answered either way. A failed tile is not cached, so the next request tries again.
+        std::vector<Waiter> waiters;
+        {
+            std::lock_guard lock(mutex_);
+            const auto it = in_flight_.find(key);
+            waiters = std::move(it->second.waiters);
+            in_flight_.erase(it);
+            if (data) {
+                cache_.put(key, data);
+                for (const auto &waiter: waiters) {
+                    record(waiter);
+                }
+            }
+        }
+        if (!data) {
+            println(stderr, "Cannot render the tile {}/{}/{}: {}", key.z, key.x, key.y, error);
+        }
+        for (const auto &waiter: waiters) {
+            if (data) {
+                respond(waiter.fd, "200 OK", "image/png", CACHE_TILE, data->data(), data->size());
+            } else {
+                respond(waiter.fd, "500 Internal Server Error", "Cannot render the tile\n");
+            }
+        }
+    }
+#else
+    void TileServer::run(int) { throw std::runtime_error("The tile server is only available on POSIX systems"); }
+    void TileServer::handle(int, const std::string &, std::chrono::steady_clock::time_point) {}
+    void TileServer::requestTile(int, const TileKey &, bool, std::chrono::steady_clock::time_point) {}
+    void TileServer::renderNext() {}
+#endif
+
+    std::vector<uchar> TileServer::renderTile(const TileKey &key) const {
+        Perf::Scope perf_scope("tileRender");
+        constexpr double ROOT_X = -2.5, ROOT_Y = -2.0, ROOT_SIZE = 4.0;
+        const auto size = ROOT_SIZE / std::ldexp(1.0, key.z);
+
+        // The tiles render concurrently, so every render runs on its worker only.
+        MandelbrotSet mandelbrot_set;
+        mandelbrot_set.setResolution(TILE_SIZE, TILE_SIZE)
+                .setXRange(ROOT_X + key.x * size, ROOT_X + (key.x + 1) * size)
+                .setYRange(ROOT_Y + key.y * size, ROOT_Y + (key.y + 1) * size)
+                .setColors(colors_)
+                .setThreadCount(1);
+
+        std::vector<uchar> png;
+        cv::imencode(".png", mandelbrot_set.generate(), png);
+        return png;
+    }
+
+    std::string TileServer::statsJson() {
+        std::lock_guard lock(mutex_);
+        auto latency = [](const LatencyStats &stats) {
+            return std::format("{{\"requests\": {}, \"p50_ms\": {:.3f}, \"p99_ms\": {:.3f}}}", stats.count(),
+                               stats.percentile(0.5), stats.percentile(0.99));
+        };
+        return std::format("{{\"hits\": {}, \"misses\": {}, \"coalesced\": {}, \"queued\": {}, \"in_flight\": {}, "
+                           "\"cache_tiles\": {}, \"cache_bytes\": {}, \"visible\": {}, \"prefetch\": {}}}\n",
+                           hits_, misses_, coalesced_, queue_.size(), in_flight_.size(), cache_.size(),
+                           cache_.bytes(), latency(visible_latency_), latency(prefetch_latency_));
+    }
+
+    void TileServer::record(const Waiter &waiter) {
+        const auto milliseconds = TIME_DIFF(waiter.start) * 1000;
+        (waiter.visible ? visible_latency_ : prefetch_latency_).add(milliseconds);
+    }
+
+} // namespace Mandelbrot
@@ -0,0 +1,179 @@
+#ifndef MANDELBROTSET_SRC_TILESERVER_H
+#define MANDELBROTSET_SRC_TILESERVER_H
+
+/**
+ * @file TileServer.h
+ * @brief A long-running HTTP server of slippy map tiles.
+ *
+ * The server listens on localhost and answers two requests:
+ *
+ *     GET /tiles/<z>/<x>/<y>.png[?prefetch=1]   A 256x256 PNG tile
+ *     GET /stats                                 The cache and latency statistics as JSON
+ *
+ * Zoom level z has 2^z x 2^z tiles over the square [-2.5, 1.5] x [-2, 2]. The encoded tiles are kept in an LRU
+ * cache bounded in bytes. Requests for a tile that is already being rendered wait for that render instead of starting
+ * their own. Visible tiles are rendered before prefetched ones, and a prefetched tile that becomes visible while it is
+ * queued is moved up.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <exec/async_scope.hpp>
+#include <exec/static_thread_pool.hpp>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include "BaseMandelbrotSet.h"
+
+namespace Mandelbrot {
+
+    /**
+     * @brief The address of a tile.
+     */
+    struct TileKey {
+        int z, x, y;
+        auto operator<=>(const TileKey &) const = default;
+    };
+
+    /**
+     * @brief The LRU cache of encoded tiles.
+     * @note Not thread-safe.
+     */
+    class TileCache {
+    public:
+        using Data = std::shared_ptr<const std::vector<uchar>>;
+
+        explicit TileCache(size_t capacity) : capacity_(capacity) {}
+
+        /**
+         * @brief Look up a tile and mark it as the most recently used.
+         * @return The tile, or nullptr if it is not cached.
+         */
+        Data get(const TileKey &key);
+
+        /**
+         * @brief Insert a tile and evict the least recently used ones beyond the capacity.
+         */
+        void put(const TileKey &key, Data data);
+
+        [[nodiscard]] size_t size() const { return index_.size(); }
+        [[nodiscard]] size_t bytes() const { return bytes_; }
+
+    private:
+        size_t capacity_;
+        size_t bytes_{0};
+        std::list<std::pair<TileKey, Data>> entries_; // The most recently used first.
+        std::map<TileKey, std::list<std::pair<TileKey, Data>>::iterator> index_;
+    };
+
+    /**
+     * @brief The latency distribution of the recent requests.
+     * @note Not thread-safe.
+     */
+    class LatencyStats {
+    public:
+        constexpr static size_t WINDOW = 4096;
+
+        void add(double milliseconds);
+
+        /**
+         * @brief Get a percentile of the recent requests.
+         * @param p The percentile in [0, 1].
+         * @return The latency in milliseconds, or zero if there is no request yet.
+         */
+        [[nodiscard]] double percentile(double p) const;
+
+        [[nodiscard]] uint64_t count() const { return count_; }
+
+    private:
+        std::vector<double> samples_;
+        uint64_t count_{0};
+    };
+
+    class TileServer {
+    public:
+#ifdef __unix__
+        constexpr static bool AVAILABLE = true;
+#else
+        constexpr static bool AVAILABLE = false;
+#endif
+        constexpr static int TILE_SIZE = 256;
+        constexpr static int MAX_ZOOM = 30;
+        constexpr static size_t CACHE_SIZE = 256 << 20;
+
+        TileServer &setColors(ColorSchemeType colors) {
+            colors_ = colors;
+            return *this;
+        }
+
+        TileServer &setCacheSize(size_t bytes) {
+            cache_ = TileCache(bytes);
+            return *this;
+        }
+
+        /**
+         * @brief Serve until the process is killed.
+         * @param port The port on 127.0.0.1.
+         * @throw std::runtime_error If the port cannot be bound.
+         */
+        void run(int port);
+
+    private:
+        struct Waiter {
+            int fd;
+            std::chrono::steady_clock::time_point start;
+            bool visible;
+        };
+
+        struct InFlight {
+            std::vector<Waiter> waiters;
+            bool visible = false;
+            bool started = false;
+        };
+
+        /**
+         * @brief A queued render. Visible renders go first, then the older ones.
+         */
+        struct Job {
+            bool visible;
+            uint64_t sequence;
+            TileKey key;
+            bool operator<(const Job &other) const {
+                return std::tie(visible, other.sequence) < std::tie(other.visible, sequence);
+            }
+        };
+
+        void handle(int fd, const std::string &request, std::chrono::steady_clock::time_point start);
+        void requestTile(int fd, const TileKey &key, bool visible, std::chrono::steady_clock::time_point start);
+        void renderNext();
+        [[nodiscard]] std::vector<uchar> renderTile(const TileKey &key) const;
+        [[nodiscard]] std::string statsJson();
+        void record(const Waiter &waiter);
+
+        ColorSchemeType colors_{nullptr};
+        std::mutex mutex_;
+        TileCache cache_{CACHE_SIZE};
+        std::map<TileKey, InFlight> in_flight_;
+        std::priority_queue<Job> queue_;
+        uint64_t sequence_{0};
+        uint64_t hits_{0}, misses_{0}, coalesced_{0};
+        LatencyStats visible_latency_, prefetch_latency_;
+
+        unsigned int worker_count_{std::max(1u, std::thread::hardware_concurrency())};
+        // The connection handlers never wait for a render or a request, so a few threads are enough.
+        unsigned int io_count_{4};
+        exec::static_thread_pool compute_pool_{worker_count_};
+        exec::static_thread_pool io_pool_{io_count_};
+        exec::async_scope scope_;
+    };
+
+} // namespace Mandelbrot
+
+#endif // MANDELBROTSET_SRC_TILESERVER_H
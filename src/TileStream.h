@@ -0,0 +1,238 @@
+#ifndef MANDELBROTSET_SRC_TILESTREAM_H
+#define MANDELBROTSET_SRC_TILESTREAM_H
+
+/**
+ * @file TileStream.h
+ * @brief Render an image as a stream of tiles on a scheduler.
+ *
+ * generateRawMatrix() returns once the slowest row is done. A tile stream instead hands out every tile as soon as it
+ * is rendered, so the next stage, e.g. colorize, an encoder or a socket, starts on the finished tiles while the rest
+ * of the image is still rendering:
+ *
+ *     auto stream = mandelbrot_set.tiles();
+ *     scope.spawn(stream.render(pool.get_scheduler()));
+ *     while (auto tile = co_await stream.next()) {
+ *         stream.colorize(*tile).copyTo(image(tile->rect));
+ *     }
+ *
+ * Every tile is a region() of the view, so its raw matrix is the same rect of the whole render, bit for bit.
+ *
+ * The consumer resumes on the thread that finished the tile. Heavy consumers should move to a scheduler of their own
+ * first, so that they do not hold up the render.
+ *
+ * If a tile fails to render, its exception is delivered through next(): the tiles that finished before are still
+ * handed out, then every waiting and every later next() completes with the error.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <optional>
+#include <stdexec/execution.hpp>
+#include <vector>
+#include "BaseMandelbrotSet.h"
+#include "RenderStats.h"
+#include "Utility.h"
+
+namespace Mandelbrot {
+
+    /**
+     * @brief A rendered tile of an image.
+     */
+    struct Tile {
+        cv::Rect rect; ///< The tile in the pixel coordinates of the image.
+        cv::Mat raw; ///< The escape times of the tile with CV_32FC1.
+        RenderStats stats;
+    };
+
+    /**
+     * @brief The tiles of an image, in the order they are rendered.
+     * @tparam MandelbrotSetImpl The Mandelbrot set implementation.
+     * @note The stream is rendered once. next() may be awaited from one consumer at a time.
+     */
+    template<typename MandelbrotSetImpl>
+    class TileStream {
+        /**
+         * @brief A consumer waiting for the next tile.
+         */
+        struct Waiter {
+            virtual void complete(std::optional<Tile> tile) noexcept = 0;
+            virtual void fail(std::exception_ptr error) noexcept = 0;
+
+        protected:
+            ~Waiter() = default;
+        };
+
+        template<typename Receiver>
+        struct NextOperation final : Waiter {
+            using operation_state_concept = ex::operation_state_t;
+
+            NextOperation(TileStream *stream, Receiver receiver) : stream_(stream), receiver_(std::move(receiver)) {}
+            NextOperation(NextOperation &&) = delete;
+
+            void start() & noexcept { stream_->await(this); }
+
+            void complete(std::optional<Tile> tile) noexcept override {
+                ex::set_value(std::move(receiver_), std::move(tile));
+            }
+
+            void fail(std::exception_ptr error) noexcept override {
+                ex::set_error(std::move(receiver_), std::move(error));
+            }
+
+        private:
+            TileStream *stream_;
+            Receiver receiver_;
+        };
+
+    public:
+        /**
+         * @brief The sender of the next tile, or std::nullopt once every tile has been handed out.
+         * @note It completes with the exception of the render once a tile failed and the finished tiles are gone.
+         */
+        struct NextSender {
+            using sender_concept = ex::sender_t;
+            using completion_signatures = ex::completion_signatures<ex::set_value_t(std::optional<Tile>),
+                                                                    ex::set_error_t(std::exception_ptr)>;
+
+            template<ex::receiver Receiver>
+            NextOperation<Receiver> connect(Receiver receiver) const {
+                return NextOperation<Receiver>(stream, std::move(receiver));
+            }
+
+            TileStream *stream;
+        };
+
+        /**
+         * @param mandelbrot_set The view to render. It is copied.
+         * @param tile_size The edge of the tiles in pixels. The tiles on the right and bottom edge may be smaller.
+         */
+        explicit TileStream(const MandelbrotSetImpl &mandelbrot_set, int tile_size = STREAM_TILE_SIZE) :
+            mandelbrot_set_(mandelbrot_set) {
+            const auto width = static_cast<int>(mandelbrot_set.getWidth());
+            const auto height = static_cast<int>(mandelbrot_set.getHeight());
+            for (int y = 0; y < height; y += tile_size) {
+                for (int x = 0; x < width; x += tile_size) {
+                    rects_.emplace_back(x, y, std::min(tile_size, width - x), std::min(tile_size, height - y));
+                }
+            }
+        }
+
+        TileStream(const TileStream &) = delete;
+        TileStream &operator=(const TileStream &) = delete;
+
+        /**
+         * @brief The tiles in row-major order.
+         */
+        [[nodiscard]] const std::vector<cv::Rect> &getRects() const { return rects_; }
+
+        /**
+         * @brief Render all tiles on a scheduler.
+         * @return The sender that completes once every tile is rendered. Start it exactly once.
+         * @note Every tile renders on a single thread, the scheduler provides the parallelism. The sender itself does
+         *       not fail, the exception of a tile goes to the consumers, see next().
+         */
+        template<ex::scheduler Scheduler>
+        [[nodiscard]] ex::sender auto render(Scheduler scheduler) {
+            return ex::schedule(scheduler) | ex::bulk(rects_.size(), [this](size_t i) noexcept {
+                       try {
+                           push(renderTile(i));
+                       } catch (...) {
+                           fail(std::current_exception());
+                       }
+                   });
+        }
+
+        /**
+         * @brief Wait for the next finished tile.
+         */
+        [[nodiscard]] NextSender next() { return NextSender{this}; }
+
+        /**
+         * @brief Colorize a tile with the colors of the view.
+         */
+        [[nodiscard]] cv::Mat colorize(const Tile &tile) const {
+            return mandelbrot_set_.region(tile.rect).colorize(tile.raw);
+        }
+
+    private:
+        [[nodiscard]] Tile renderTile(size_t index) const {
+            const auto &rect = rects_[index];
+            auto part = mandelbrot_set_.region(rect);
+            if constexpr (requires { part.setThreadCount(1); }) {
+                part.setThreadCount(1);
+            }
+            Tile tile{rect};
+            tile.raw = part.generateRawMatrix(tile.stats);
+            return tile;
+        }
+
+        void push(Tile tile) {
+            std::unique_lock lock(mutex_);
+            if (waiters_.empty()) {
+                ready_.push_back(std::move(tile));
+                return;
+            }
+            auto *waiter = waiters_.front();
+            waiters_.pop_front();
+            ++delivered_;
+            lock.unlock();
+            waiter->complete(std::move(tile));
+        }
+
+        /**
+         * @brief Keep the first error of the render and fail all parked consumers with it.
+         */
+        void fail(std::exception_ptr error) noexcept {
+            std::deque<Waiter *> waiters;
+            {
+                std::lock_guard lock(mutex_);
+                if (!error_) {
+                    error_ = std::move(error);
+                }
+                waiters.swap(waiters_);
+            }
+            for (auto *waiter: waiters) {
+                waiter->fail(error_);
+            }
+        }
+
+        void await(Waiter *waiter) {
+            std::unique_lock lock(mutex_);
+            if (!ready_.empty()) {
+                auto tile = std::move(ready_.front());
+                ready_.pop_front();
+                ++delivered_;
+                lock.unlock();
+                waiter->complete(std::move(tile));
+            } else if (error_) {
+                lock.unlock();
+                waiter->fail(error_);
+            } else if (delivered_ == rects_.size()) {
+                lock.unlock();
+                waiter->complete(std::nullopt);
+            } else {
+                waiters_.push_back(waiter);
+            }
+        }
+
+        MandelbrotSetImpl mandelbrot_set_;
+        std::vector<cv::Rect> rects_;
+        std::mutex mutex_;
+        std::deque<Tile> ready_;
+        std::deque<Waiter *> waiters_;
+        size_t delivered_{0};
+        std::exception_ptr error_; ///< The first failure of the render. It is never reset.
+    };
+
+    template<typename Derived>
+    TileStream<Derived> BaseMandelbrotSet<Derived>::tiles(int tile_size) const {
+        return TileStream<Derived>(static_cast<const Derived &>(*this), tile_size);
+    }
+
+} // namespace Mandelbrot
+
+#endif // MANDELBROTSET_SRC_TILESTREAM_H
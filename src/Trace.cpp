@@ -0,0 +1,135 @@
+#include "Trace.h"
+
+#ifdef ENABLE_TRACING
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Mandelbrot::Trace {
+
+    namespace {
+        // Events per thread. Older events are overwritten once a thread records more than this.
+        constexpr size_t CAPACITY = 1 << 16;
+
+        struct Event {
+            const char *name;
+            int64_t begin_ns, end_ns;
+            int32_t keyframe, frame;
+        };
+
+        /**
+         * @brief The ring buffer of one thread. Only the owner thread writes to it.
+         */
+        struct Buffer {
+            explicit Buffer(uint32_t tid) : tid(tid) {}
+
+            std::array<Event, CAPACITY> events{};
+            std::atomic<uint64_t> head{0};
+            uint32_t tid;
+        };
+
+        struct Registry {
+            std::mutex mutex;
+            std::vector<std::unique_ptr<Buffer>> buffers;
+            std::string path;
+            std::atomic<bool> enabled{false};
+            const std::chrono::steady_clock::time_point epoch{std::chrono::steady_clock::now()};
+        };
+
+        Registry &registry() {
+            static Registry instance;
+            return instance;
+        }
+
+        // The lock is only taken once per thread, on its first event. Buffers outlive their threads so that the
+        // events of finished pools can still be exported.
+        Buffer &localBuffer() {
+            thread_local Buffer *buffer = [] {
+                auto &reg = registry();
+                std::lock_guard lock(reg.mutex);
+                auto tid = static_cast<uint32_t>(reg.buffers.size() + 1);
+                return reg.buffers.emplace_back(std::make_unique<Buffer>(tid)).get();
+            }();
+            return *buffer;
+        }
+
+        void writeEscaped(std::ofstream &out, const char *text) {
+            for (; *text; ++text) {
+                if (*text == '"' || *text == '\\') {
+                    out << '\\';
+                }
+                out << *text;
+            }
+        }
+    } // namespace
+
+    void setOutput(const std::string &path) {
+        auto &reg = registry();
+        {
+            std::lock_guard lock(reg.mutex);
+            reg.path = path;
+        }
+        if (!reg.enabled.exchange(true)) {
+            std::atexit(dump);
+        }
+    }
+
+    bool enabled() { return registry().enabled.load(std::memory_order_relaxed); }
+
+    void record(const char *name, std::chrono::steady_clock::time_point begin,
+                std::chrono::steady_clock::time_point end, int32_t keyframe, int32_t frame) {
+        const auto epoch = registry().epoch;
+        auto &buffer = localBuffer();
+        const auto head = buffer.head.load(std::memory_order_relaxed);
+        buffer.events[head % CAPACITY] = Event{
+                name,
+                std::chrono::duration_cast<std::chrono::nanoseconds>(begin - epoch).count(),
+                std::chrono::duration_cast<std::chrono::nanoseconds>(end - epoch).count(),
+                keyframe,
+                frame,
+        };
+        buffer.head.store(head + 1, std::memory_order_release);
+    }
+
+    void dump() {
+        auto &reg = registry();
+        std::lock_guard lock(reg.mutex);
+        if (reg.path.empty()) {
+            return;
+        }
+
+        std::ofstream out(reg.path);
+        if (!out) {
+            std::fprintf(stderr, "Cannot write the trace to %s\n", reg.path.c_str());
+            return;
+        }
+
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        for (const auto &buffer: reg.buffers) {
+            const auto head = buffer->head.load(std::memory_order_acquire);
+            const auto count = std::min<uint64_t>(head, CAPACITY);
+            for (auto i = head - count; i < head; ++i) {
+                const auto &event = buffer->events[i % CAPACITY];
+                out << (first ? "\n" : ",\n") << "{\"name\":\"";
+                writeEscaped(out, event.name);
+                out << std::format("\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}", buffer->tid,
+                                   event.begin_ns / 1e3, (event.end_ns - event.begin_ns) / 1e3);
+                out << std::format(",\"args\":{{\"keyframe\":{},\"frame\":{}}}}}", event.keyframe, event.frame);
+                first = false;
+            }
+        }
+        out << "\n]}\n";
+    }
+
+} // namespace Mandelbrot::Trace
+
+#endif // ENABLE_TRACING
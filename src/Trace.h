@@ -0,0 +1,102 @@
+#ifndef MANDELBROTSET_SRC_TRACE_H
+#define MANDELBROTSET_SRC_TRACE_H
+
+/**
+ * @file Trace.h
+ * @brief Low overhead pipeline tracing in the Chrome trace event format.
+ *
+ * Each thread records complete events into its own ring buffer, so recording takes no lock. The buffers are exported
+ * as Chrome trace JSON at exit, which can be opened in chrome://tracing or https://ui.perfetto.dev.
+ *
+ * Tracing is compiled in with ENABLE_TRACING. Without it MANDELBROT_TRACE_SCOPE expands to nothing.
+ */
+
+#include <cstdint>
+#include <string>
+
+#ifdef ENABLE_TRACING
+#include <chrono>
+#endif
+
+namespace Mandelbrot::Trace {
+
+#ifdef ENABLE_TRACING
+    /**
+     * @brief Whether tracing is compiled in.
+     */
+    constexpr bool AVAILABLE = true;
+
+    /**
+     * @brief Start recording and export the trace to the given path at exit.
+     * @param path The path of the Chrome trace JSON file.
+     */
+    void setOutput(const std::string &path);
+
+    /**
+     * @brief Check whether events are being recorded.
+     */
+    bool enabled();
+
+    /**
+     * @brief Record a complete event on the calling thread.
+     * @param name The name of the stage. It must outlive the trace, a string literal in practice.
+     * @param begin The begin time.
+     * @param end The end time.
+     * @param keyframe The keyframe index, or -1.
+     * @param frame The frame index inside the keyframe, or -1.
+     */
+    void record(const char *name, std::chrono::steady_clock::time_point begin,
+                std::chrono::steady_clock::time_point end, int32_t keyframe, int32_t frame);
+
+    /**
+     * @brief Write all recorded events to the output path.
+     * @note It should be called when the traced threads are idle. It is called automatically at exit.
+     */
+    void dump();
+
+    /**
+     * @brief Record the lifetime of the scope as a complete event.
+     */
+    class Scope {
+    public:
+        explicit Scope(const char *name, int32_t keyframe = -1, int32_t frame = -1) :
+            name_(name), keyframe_(keyframe), frame_(frame) {
+            if (enabled()) {
+                begin_ = std::chrono::steady_clock::now();
+            }
+        }
+
+        ~Scope() {
+            if (begin_ != std::chrono::steady_clock::time_point{}) {
+                record(name_, begin_, std::chrono::steady_clock::now(), keyframe_, frame_);
+            }
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        const char *name_;
+        int32_t keyframe_, frame_;
+        std::chrono::steady_clock::time_point begin_{};
+    };
+
+#define MANDELBROT_TRACE_CONCAT_IMPL(a, b) a##b
+#define MANDELBROT_TRACE_CONCAT(a, b) MANDELBROT_TRACE_CONCAT_IMPL(a, b)
+#define MANDELBROT_TRACE_SCOPE(name, ...)                                                                              \
+    ::Mandelbrot::Trace::Scope MANDELBROT_TRACE_CONCAT(trace_scope_, __LINE__) { name __VA_OPT__(, ) __VA_ARGS__ }
+#else
+    constexpr bool AVAILABLE = false;
+
+    inline void setOutput(const std::string &) {}
+    inline bool enabled() { return false; }
+    inline void dump() {}
+
+#define MANDELBROT_TRACE_SCOPE(name, ...)                                                                              \
+    do {                                                                                                               \
+    } while (0)
+#endif
+
+} // namespace Mandelbrot::Trace
+
+#endif // MANDELBROTSET_SRC_TRACE_H
@@ -0,0 +1,229 @@
+#include "Tuning.h"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <format>
+#include <limits>
+#include <thread>
+#include <vector>
+#include "MandelbrotSet.h"
+#include "MandelbrotSetSimd.h"
+#include "Utility.h"
+#if ENABLE_OPENMP
+#include <omp.h>
+#endif
+
+namespace Mandelbrot {
+    namespace {
+        /**
+         * @brief A representative view of a scene class, taken from the benchmark corpus.
+         */
+        struct TuningScene {
+            SceneClass scene_class;
+            double x_center, y_center, xsize;
+        };
+
+        constexpr TuningScene TUNING_SCENES[] = {
+                {SceneClass::Interior, -0.15, 0.0, 0.4},
+                {SceneClass::Boundary, -0.74525, 0.12265, 0.02},
+        };
+
+        constexpr int TUNING_LANES[] = {1, 4, 8};
+        constexpr Schedule TUNING_SCHEDULES[] = {Schedule::Static, Schedule::Dynamic, Schedule::Guided};
+        constexpr int TUNING_CHUNKS[] = {0, 1, 8};
+
+        std::array<std::optional<Tuning>, SCENE_CLASS_COUNT> tunings;
+
+        std::string coreCount() { return std::to_string(std::max(1u, std::thread::hardware_concurrency())); }
+
+        std::optional<int> parseInt(std::string_view text) {
+            int value = 0;
+            const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+            if (text.empty() || error != std::errc{} || end != text.data() + text.size() || value < 0) {
+                return std::nullopt;
+            }
+            return value;
+        }
+
+        template<typename MandelbrotSetImpl>
+        double measure(const TuningScene &scene, const Tuning &tuning) {
+            MandelbrotSetImpl mandelbrot_set(Tuning::TUNING_SIZE, Tuning::TUNING_SIZE);
+            mandelbrot_set.setCenter(scene.x_center, scene.y_center, scene.xsize)
+                    .setThreadCount(tuning.threads)
+                    .setSchedule(tuning.schedule, tuning.chunk);
+            [[maybe_unused]] auto warm_up = mandelbrot_set.generateRawMatrix();
+            auto best = std::numeric_limits<double>::infinity();
+            for (int i = 0; i < Tuning::TUNING_RUNS; ++i) {
+                const auto start = std::chrono::steady_clock::now();
+                [[maybe_unused]] auto matrix = mandelbrot_set.generateRawMatrix();
+                best = std::min(best, TIME_DIFF(start));
+            }
+            return best;
+        }
+
+        double measure(const TuningScene &scene, const Tuning &tuning) {
+            switch (tuning.lanes) {
+                case 1:
+                    return measure<MandelbrotSet>(scene, tuning);
+                case 4:
+                    return measure<MandelbrotSetSimd4>(scene, tuning);
+                default:
+                    return measure<MandelbrotSetSimd8>(scene, tuning);
+            }
+        }
+    } // namespace
+
+    std::optional<Schedule> parseSchedule(std::string_view name) {
+        if (name == "static") {
+            return Schedule::Static;
+        } else if (name == "dynamic") {
+            return Schedule::Dynamic;
+        } else if (name == "guided") {
+            return Schedule::Guided;
+        }
+        return std::nullopt;
+    }
+
+    std::string_view scheduleName(Schedule schedule) {
+        switch (schedule) {
+            case Schedule::Static:
+                return "static";
+            case Schedule::Guided:
+                return "guided";
+            case Schedule::Dynamic:
+            default:
+                return "dynamic";
+        }
+    }
+
+    void useSchedule([[maybe_unused]] Schedule schedule, [[maybe_unused]] int chunk) {
+#if ENABLE_OPENMP
+        switch (schedule) {
+            case Schedule::Static:
+                omp_set_schedule(omp_sched_static, chunk);
+                break;
+            case Schedule::Guided:
+                omp_set_schedule(omp_sched_guided, chunk);
+                break;
+            case Schedule::Dynamic:
+            default:
+                omp_set_schedule(omp_sched_dynamic, chunk);
+                break;
+        }
+#endif
+    }
+
+    std::string_view sceneClassName(SceneClass scene_class) {
+        return scene_class == SceneClass::Interior ? "interior" : "boundary";
+    }
+
+    SceneClass classifyScene(double x_min, double x_max, double y_min, double y_max) {
+        constexpr int size = Tuning::PROBE_SIZE;
+        int interior = 0;
+        for (int y = 0; y < size; ++y) {
+            const double ci = y_min + (y + 0.5) * (y_max - y_min) / size;
+            for (int x = 0; x < size; ++x) {
+                const double cr = x_min + (x + 0.5) * (x_max - x_min) / size;
+                if (MandelbrotFormula::inMainBulbs(cr, ci)) {
+                    ++interior;
+                    continue;
+                }
+                double zr = 0.0, zi = 0.0;
+                size_t n = 0;
+                while (n < MAX_ITERATIONS && zr * zr + zi * zi <= ESCAPE_RADIUS_SQ) {
+                    MandelbrotFormula::step(zr, zi, cr, ci);
+                    ++n;
+                }
+                interior += n == MAX_ITERATIONS;
+            }
+        }
+        return interior >= Tuning::INTERIOR_SHARE * size * size ? SceneClass::Interior : SceneClass::Boundary;
+    }
+
+    std::string Tuning::toString() const {
+        const auto engine = lanes == 1 ? std::string("openmp") : std::format("simd{}", lanes);
+        const auto chunks = chunk == 0 ? std::string("default chunks") : std::format("{} rows per chunk", chunk);
+        const auto thread_count = threads == 0 ? std::string("default threads") : std::format("{} threads", threads);
+        return std::format("{}, {} schedule, {}, {}", engine, scheduleName(schedule), chunks, thread_count);
+    }
+
+    bool loadTunings(const Profile &profile) {
+        tunings = {};
+        if (profile.get("tune.cores") != coreCount()) {
+            return false;
+        }
+
+        bool loaded = false;
+        for (int i = 0; i < SCENE_CLASS_COUNT; ++i) {
+            const auto prefix = std::format("tune.{}.", sceneClassName(static_cast<SceneClass>(i)));
+            const auto lanes = profile.get(prefix + "lanes").and_then(parseInt);
+            const auto schedule = profile.get(prefix + "schedule").and_then(parseSchedule);
+            const auto chunk = profile.get(prefix + "chunk").and_then(parseInt);
+            const auto threads = profile.get(prefix + "threads").and_then(parseInt);
+            if (!lanes || !schedule || !chunk || !threads ||
+                std::ranges::find(TUNING_LANES, *lanes) == std::end(TUNING_LANES)) {
+                continue;
+            }
+            tunings[i] = Tuning{.lanes = *lanes, .schedule = *schedule, .chunk = *chunk, .threads = *threads};
+            loaded = true;
+        }
+        return loaded;
+    }
+
+    bool hasTunings() {
+        return std::ranges::any_of(tunings, [](const auto &tuning) { return tuning.has_value(); });
+    }
+
+    std::optional<Tuning> tuningFor(SceneClass scene_class) { return tunings[static_cast<int>(scene_class)]; }
+
+    void autotune(Profile &profile) {
+        println(stdout, "Tuning the CPU engines on {}", Profile::hostname());
+        profile.erase("tune.");
+
+        // Hyper-threads share the vector units, so half the threads may beat all of them on the lane-batched loops.
+        const auto cores = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        std::vector<int> thread_counts{cores};
+        if (cores > 1) {
+            thread_counts.push_back(cores / 2);
+        }
+
+        for (const auto &scene: TUNING_SCENES) {
+            const Tuning baseline{.threads = cores};
+            const auto baseline_time = measure(scene, baseline);
+            auto best = baseline;
+            auto best_time = baseline_time;
+            for (const auto lanes: TUNING_LANES) {
+                for (const auto threads: thread_counts) {
+                    for (const auto schedule: TUNING_SCHEDULES) {
+                        for (const auto chunk: TUNING_CHUNKS) {
+                            const Tuning tuning{
+                                    .lanes = lanes, .schedule = schedule, .chunk = chunk, .threads = threads};
+                            const auto seconds = measure(scene, tuning);
+                            if (seconds < best_time) {
+                                best = tuning;
+                                best_time = seconds;
+                            }
+                        }
+                    }
+                }
+            }
+
+            const auto name = sceneClassName(scene.scene_class);
+            println(stdout, "    {:<8} {:8.2f} ms, {:.2f}x the default: {}", name, best_time * 1000,
+                    baseline_time / best_time, best.toString());
+            const auto prefix = std::format("tune.{}.", name);
+            profile.set(prefix + "lanes", std::to_string(best.lanes))
+                    .set(prefix + "schedule", std::string(scheduleName(best.schedule)))
+                    .set(prefix + "chunk", std::to_string(best.chunk))
+                    .set(prefix + "threads", std::to_string(best.threads))
+                    .set(prefix + "ms", std::format("{:.3f}", best_time * 1000));
+        }
+
+        profile.set("tune.cores", coreCount());
+        if (!profile.save()) {
+            println(stderr, "Cannot write the profile {}", profile.getPath().string());
+        }
+    }
+
+} // namespace Mandelbrot
@@ -0,0 +1,101 @@
+#ifndef MANDELBROTSET_SRC_TUNING_H
+#define MANDELBROTSET_SRC_TUNING_H
+
+/**
+ * @file Tuning.h
+ * @brief The render settings of the CPU engines, tuned per host and scene class.
+ *
+ * The best lane count, OpenMP schedule and thread count depend on the CPU as much as on the view: the rows of an
+ * interior-heavy view all cost the same, while the cost of the rows around the boundary varies by orders of magnitude.
+ * autotune() sweeps the settings on a short render of a representative view of every scene class and keeps the
+ * fastest in the profile of the host. loadTunings() reads them back at startup, and the tuned backend renders every
+ * view with the settings of its class.
+ */
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include "Profile.h"
+
+namespace Mandelbrot {
+
+    /**
+     * @brief How the rows of a render are spread over the threads.
+     */
+    enum class Schedule {
+        Static, ///< Fixed blocks, or round robin with a chunk size.
+        Dynamic, ///< Every thread takes the next chunk when it is done.
+        Guided, ///< Like dynamic, with chunks that shrink towards the end.
+    };
+
+    std::optional<Schedule> parseSchedule(std::string_view name);
+    std::string_view scheduleName(Schedule schedule);
+
+    /**
+     * @brief Set the schedule of the next `omp for schedule(runtime)` loops started from this thread.
+     * @param chunk The rows a thread takes at a time. Zero uses the default of the schedule.
+     */
+    void useSchedule(Schedule schedule, int chunk);
+
+    /**
+     * @brief The kinds of views that are tuned separately.
+     */
+    enum class SceneClass {
+        Interior, ///< Many pixels run to the iteration limit, so all rows cost about the same.
+        Boundary, ///< Few interior pixels, and row costs that vary widely.
+    };
+
+    constexpr int SCENE_CLASS_COUNT = 2;
+
+    std::string_view sceneClassName(SceneClass scene_class);
+
+    /**
+     * @brief Classify a view by a coarse probe of its escape times.
+     * @note The probe is PROBE_SIZE x PROBE_SIZE pixels on the calling thread, i.e. about a millisecond at most.
+     */
+    SceneClass classifyScene(double x_min, double x_max, double y_min, double y_max);
+
+    /**
+     * @brief The render settings of a scene class.
+     */
+    struct Tuning {
+        constexpr static int PROBE_SIZE = 32;
+        constexpr static double INTERIOR_SHARE = 0.25; ///< The interior pixels of the probe of an interior view.
+        constexpr static int TUNING_SIZE = 256; ///< The resolution of the sweep renders.
+        constexpr static int TUNING_RUNS = 3; ///< The best of these runs counts, after a warm-up.
+
+        int lanes = 8; ///< 1 for the OpenMP engine, 4 or 8 for the lane-batched ones.
+        Schedule schedule = Schedule::Dynamic;
+        int chunk = 0;
+        int threads = 0; ///< Zero uses the OpenMP default.
+
+        [[nodiscard]] std::string toString() const;
+    };
+
+    /**
+     * @brief Load the tunings from the profile of the host.
+     * @return Whether any scene class has a tuning.
+     * @note The tunings are only used if they were measured with the same cores. Call this at startup, before any
+     *       render with the tuned backend.
+     */
+    bool loadTunings(const Profile &profile);
+
+    /**
+     * @brief Whether any tuning is loaded.
+     */
+    bool hasTunings();
+
+    /**
+     * @brief The loaded tuning of a scene class, or std::nullopt if the class is not tuned.
+     */
+    std::optional<Tuning> tuningFor(SceneClass scene_class);
+
+    /**
+     * @brief Sweep the settings on every scene class and write the fastest to the profile.
+     * @note This takes from a few seconds to a minute, depending on the cores.
+     */
+    void autotune(Profile &profile);
+
+} // namespace Mandelbrot
+
+#endif // MANDELBROTSET_SRC_TUNING_H
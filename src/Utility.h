@@ -17,6 +17,7 @@
 #include <fmt/core.h>
 #include <fmt/std.h>
 #endif
+#include <latch>
 #include <queue>
 #include <ranges>
 #include <stdexec/concepts.hpp>
@@ -91,6 +92,23 @@ namespace Mandelbrot {
         std::function<void()> func;
     };
 
+    /**
+     * @brief Run a function once on every thread of a thread pool, e.g. to pin it.
+     * @param scheduler The scheduler of the pool.
+     * @param thread_count The threads of the pool. Never more, or the call waits forever.
+     * @param function Called with the index of the thread, from 0 to thread_count - 1.
+     * @note A bulk alone may run several items on one thread, since the threads steal work from each other. Every item
+     *       waits here until all of them have started, so thread_count items take thread_count distinct threads.
+     */
+    template<ex::scheduler Scheduler, typename Function>
+    void onEveryThread(Scheduler scheduler, unsigned int thread_count, Function function) {
+        std::latch started(thread_count);
+        ex::sync_wait(ex::schedule(scheduler) | ex::bulk(thread_count, [&started, &function](size_t i) {
+                          started.arrive_and_wait();
+                          function(i);
+                      }));
+    }
+
     namespace views = std::views;
     namespace ranges = std::ranges;
 
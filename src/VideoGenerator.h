@@ -13,63 +13,109 @@
 #include <exec/async_scope.hpp>
 #include <exec/static_thread_pool.hpp>
 #include <exec/task.hpp>
+#include <filesystem>
+#include <format>
 #include <iostream>
+#include <optional>
 #include <opencv2/core.hpp>
 #include <opencv2/imgcodecs.hpp>
 #include <opencv2/imgproc.hpp>
 #include <opencv2/videoio.hpp>
 #include <ranges>
+#include <sstream>
 #include <stdexec/coroutine.hpp>
 #include <stdexec/execution.hpp>
 #include <utility>
 #include "Algorithm.h"
+#include "ColorSchemes.h"
+#include "FrameSink.h"
+#include "ImageWriter.h"
 #include "MandelbrotSet.h"
 #include "MandelbrotSetCuda.h"
+#include "Nucleus.h"
+#include "Numa.h"
+#include "PerfCounters.h"
+#include "RenderJournal.h"
+#include "RuntimeMandelbrotSet.h"
+#include "ThreadBudget.h"
+#include "Trace.h"
 #include "Utility.h"
+#include "Yuv.h"
 
 /**
  * The asynchronous generator flow is as follows:
  * flowchart
- *     KeyFrameGen --> ImgWrite[cv::imwrite]
+ *     KeyFrameGen --> ImgWrite[Keyframe image writer]
  *     KeyFrameGen --> TransFrames[Intermediate Frames]
- *     TransFrames --> VideoWrite[cv::VideoWriter.write]
+ *     TransFrames --> VideoWrite[FrameSink.write]
  *     TransFrames --> |Waiting| KeyFrameGen
+ *
+ * The keyframe render, the intermediate frames and the image writes run concurrently, each on its share of the
+ * ThreadBudget, see ThreadBudget.h.
+ *
+ * The center of every keyframe is fixed before the first one renders. With auto-detect, the zoom targets are searched
+ * on cheap scout renders first, so the keyframes do not depend on each other and several of them render at once.
+ *
+ * With a checkpoint directory, every segment is written to a file of its own and recorded in a RenderJournal, together
+ * with the center of every keyframe and the written keyframe images. A resumed render starts at the first keyframe
+ * whose segment or image is missing, and the segments are concatenated into the video at the end.
  */
 
 namespace Mandelbrot {
 
+    /**
+     * @brief How the intermediate frames between two keyframes are generated.
+     */
+    enum class InterpolationMode {
+        Forward, ///< Zoom in the previous keyframe only.
+        Bidirectional, ///< Blend the zoomed-in previous keyframe with the zoomed-out next keyframe.
+    };
+
     /**
      * @brief The video generator class.
      * @tparam MandelbrotSetImpl The Mandelbrot set implementation.
      */
-    template<typename MandelbrotSetImpl =
-#ifdef ENABLE_CUDA
-                     MandelbrotSetCuda
-#else
-                     MandelbrotSet
-#endif
-             >
+    template<typename MandelbrotSetImpl = RuntimeMandelbrotSet>
     class VideoGenerator {
     public:
         using PointType = cv::Point2d;
 
-        // Constants for the grid detection
+        // Constants for the zoom target search. The search window is the central 1 / DIVIDE of the keyframe, and the
+        // quadtree stops at cells of MIN_TARGET_SIZE pixels.
         constexpr static int DIVIDE = 7;
-        constexpr static int BLOCK_SIZE = 4;
+        constexpr static int MIN_TARGET_SIZE = 8;
+        constexpr static std::string_view NUCLEUS_SETTING = "nucleus_target"; ///< The journal key of the nucleus.
+
+        // Every intermediate frame is resampled in this many row bands, so that a single frame is spread over
+        // several workers.
+        constexpr static int ZOOM_BANDS = 4;
+
+        // The auto-detected trajectory is planned on scout renders of 1 / SCOUT_DIVISOR of the resolution. Up to
+        // KEYFRAME_CONCURRENCY keyframes of the planned trajectory then render at once.
+        constexpr static int SCOUT_DIVISOR = 4;
+        constexpr static size_t KEYFRAME_CONCURRENCY = 4;
 
         /**
          * @brief Get the worker count.
          * @return worker count
-         * @note The worker count is auto detected.
+         * @note The worker count is the warp share of the thread budget.
          */
-        unsigned int getWorkerCount() const { return worker_count_; }
+        unsigned int getWorkerCount() const { return budget_.share(Stage::Warp); }
 
         /**
          * @brief Get the IO count.
          * @return IO count
-         * @note The IO count is auto detected.
+         * @note The IO count is the image write share of the thread budget.
          */
-        unsigned int getIOCount() const { return io_count_; }
+        unsigned int getIOCount() const { return budget_.share(Stage::ImageWrite); }
+
+        /**
+         * @brief Set the threads of the stages. By default, all hardware threads are split.
+         */
+        VideoGenerator &setThreadBudget(const ThreadBudget &budget) {
+            budget_ = budget;
+            return *this;
+        }
 
         // Settings for video generation
         VideoGenerator &setResolution(size_t width, size_t height) {
@@ -112,6 +158,16 @@ namespace Mandelbrot {
 
         VideoGenerator &setColors(ColorSchemeType colors) {
             mandelbrot_set_.setColors(colors);
+            color_seed_.reset();
+            return *this;
+        }
+
+        /**
+         * @brief Color with randomScheme(seed). The seed is kept in the journal, so a resumed render keeps its colors.
+         */
+        VideoGenerator &setColorSeed(uint32_t seed) {
+            mandelbrot_set_.setColors(randomScheme(seed));
+            color_seed_ = seed;
             return *this;
         }
 
@@ -130,23 +186,101 @@ namespace Mandelbrot {
             return *this;
         }
 
+        /**
+         * @brief Aim the auto-detected trajectory at a nucleus near the first zoom target, see Nucleus.h.
+         * @note The nucleus is searched for the depth of the last keyframe, and every keyframe after the first one is
+         *       centered on it. If none is found, the trajectory follows the boundary as usual. The nucleus is recorded
+         *       in the journal, so a resumed render aims at the same one.
+         */
+        VideoGenerator &setNucleus(bool nucleus) {
+            nucleus_ = nucleus;
+            return *this;
+        }
+
         VideoGenerator &setShowGrid(bool show_grid) {
             show_grid_ = show_grid;
             return *this;
         }
 
+        VideoGenerator &setInterpolationMode(InterpolationMode mode) {
+            interpolation_mode_ = mode;
+            return *this;
+        }
+
         VideoGenerator &setVideoName(const std::string &video_name) {
             video_name_ = video_name;
             return *this;
         }
 
+        VideoGenerator &setWriteKeyframes(bool write_keyframes) {
+            write_keyframes_ = write_keyframes;
+            return *this;
+        }
+
+        VideoGenerator &setKeyframeDirectory(const std::string &keyframe_directory) {
+            keyframe_directory_ = keyframe_directory;
+            return *this;
+        }
+
+        VideoGenerator &setKeyframeFormat(ImageFormat image_format) {
+            image_format_ = image_format;
+            return *this;
+        }
+
+        // -1 keeps the default compression level of OpenCV.
+        VideoGenerator &setPngCompression(int png_compression) {
+            png_compression_ = png_compression;
+            return *this;
+        }
+
+        VideoGenerator &setVideoFormat(VideoFormat video_format) {
+            video_format_ = video_format;
+            return *this;
+        }
+
+        /**
+         * @brief Colorize, warp and write the frames in I420 instead of BGR, see Yuv.h. The resolution must be even.
+         * @note Y4M takes the frames as they are. The other formats and the keyframe images convert them to BGR.
+         */
+        VideoGenerator &setYuv(bool yuv) {
+            yuv_ = yuv;
+            return *this;
+        }
+
+        VideoGenerator &setFps(double fps) {
+            fps_ = fps;
+            return *this;
+        }
+
+        /**
+         * @brief Keep a journal and the segments of the video in a directory, so that the render can be resumed.
+         */
+        VideoGenerator &setCheckpointDirectory(const std::string &checkpoint_directory) {
+            checkpoint_directory_ = checkpoint_directory;
+            return *this;
+        }
+
+        /**
+         * @brief Continue the render recorded in the checkpoint directory instead of starting over.
+         */
+        VideoGenerator &setResume(bool resume) {
+            resume_ = resume;
+            return *this;
+        }
+
         /**
          * @brief Start the video generation.
+         * @throw std::runtime_error if the checkpoint cannot be resumed with these settings, or if I420 frames are
+         *        requested for an odd resolution.
          */
         void start() {
+            if (yuv_ && (mandelbrot_set_.getWidth() % 2 != 0 || mandelbrot_set_.getHeight() % 2 != 0)) {
+                throw std::runtime_error("I420 frames require an even resolution");
+            }
             println(stdout, "Generating video...");
-            println(stdout, "Working threads: {}", worker_count_);
-            println(stdout, "IO threads: {}", io_count_);
+            println(stdout, "Render threads: {}", budget_.share(Stage::Render));
+            println(stdout, "Working threads: {}", budget_.share(Stage::Warp));
+            println(stdout, "IO threads: {}", budget_.share(Stage::ImageWrite));
             println(stdout, "Resolution: {} x {}", mandelbrot_set_.getWidth(), mandelbrot_set_.getHeight());
             println(stdout, "Center: {}, {}", center_.x, center_.y);
             println(stdout, "Initial size: {} x {}", xsize_, ysize_);
@@ -154,103 +288,447 @@ namespace Mandelbrot {
             println(stdout, "Zoom factor: {}", zoom_factor_);
             println(stdout, "Scale rate: {}", scale_rate_);
             println(stdout, "Frame count: {}", frame_count_);
+            println(stdout, "Interpolation: {}",
+                    interpolation_mode_ == InterpolationMode::Bidirectional ? "bidirectional" : "forward");
+            println(stdout, "Frame layout: {}", yuv_ ? "I420" : "BGR");
+
+            if (write_keyframes_) {
+                println(stdout, "Keyframes: {}/*.{}", keyframe_directory_, imageExtension(image_format_));
+                std::filesystem::create_directories(keyframe_directory_);
+            }
+
+            const auto first_step = openJournal();
+            if (journal_) {
+                println(stdout, "Checkpoint: {}", checkpoint_directory_);
+            }
+            if (first_step > 0) {
+                println(stdout, "Resuming at keyframe {} of {}", first_step, max_step_);
+            }
+
+            // The pools are only started here, so that they follow the budget set after construction.
+            compute_pool_.emplace(budget_.share(Stage::Warp));
+            io_pool_.emplace(budget_.share(Stage::ImageWrite));
+            budget_.limitOpenMP(Stage::Render);
+
+            if (Numa::pinning()) {
+                println(stdout, "NUMA nodes: {}", Numa::nodes().size());
+                pinPool(*compute_pool_, budget_.share(Stage::Warp));
+                pinPool(*io_pool_, budget_.share(Stage::ImageWrite));
+            }
 
             // Start Timer
             start_ = std::chrono::steady_clock::now();
+            budget_.start();
+            // The frames are first written by the warp, so their pages live with the threads that fill them.
             frames_.resize(frame_count_);
+            for (auto &frame: frames_) {
+                frame.allocator = Numa::allocator();
+            }
             transform_matrices_.resize(frame_count_);
+            if (interpolation_mode_ == InterpolationMode::Bidirectional) {
+                blend_frames_.resize(frame_count_);
+                for (auto &frame: blend_frames_) {
+                    frame.allocator = Numa::allocator();
+                }
+                blend_matrices_.resize(frame_count_);
+            }
 
             done_ = std::stop_source{};
+            segment_ = static_cast<int>(first_step);
             exec::async_scope scope;
-            auto sched = compute_pool_.get_scheduler();
+            auto sched = compute_pool_->get_scheduler();
+
+            // The whole trajectory is known before the first keyframe, so the keyframes do not wait for each other.
+            const auto plan = planTrajectory(first_step);
+            if (auto_detect_) {
+                println(stdout, "Trajectory planned at {}s", TIME_DIFF(start_));
+            }
 
             scope.spawn(ex::starts_on(sched, interpolateFrames()));
 
-            // Generate the steps for keyframe generation.
-            // It can be easily done by using traditional for loop, but I want to use ranges.
-            // Just for fun.
-            auto steps = views::zip( //
-                    views::iota(0u, max_step_), //
-                    views::iota(0u, max_step_) | views::transform([this, factor = 1.0](auto) mutable {
-                        auto res = factor;
-                        factor *= this->zoom_factor_;
-                        return res;
-                    }));
-
-            PointType center = cv::Point2f(mandelbrot_set_.getWidth() / 2.0, mandelbrot_set_.getHeight() / 2.0);
-
-            for (auto [step, factor]: steps) {
-                println(stdout, "Generating keyframe {} on thread {} at {}s", step, std::this_thread::get_id(),
-                        TIME_DIFF(start_));
-                mandelbrot_set_.setCenter(center_.x, center_.y, xsize_ / factor, ysize_ / factor);
-                cv::Mat res;
-                if (auto_detect_) {
-                    auto mat = mandelbrot_set_.generateRawMatrix();
-                    auto mask = detectHighGradient(mat);
-                    auto l = mat.cols / DIVIDE * (DIVIDE / 2), r = mat.cols / DIVIDE * (DIVIDE / 2 + 1);
-                    auto t = mat.rows / DIVIDE * (DIVIDE / 2), b = mat.rows / DIVIDE * (DIVIDE / 2 + 1);
-                    auto w = mat.cols / (DIVIDE * BLOCK_SIZE), h = mat.rows / (DIVIDE * BLOCK_SIZE);
-                    auto sums = views::cartesian_product(views::iota(0, BLOCK_SIZE), views::iota(0, BLOCK_SIZE)) //
-                                | views::transform([&](const auto &p) {
-                                      auto [i, j] = p;
-                                      return std::make_tuple(cv::Rect(l + i * w, t + j * h, w, h), i, j);
-                                  }) //
-                                | views::transform([&mask](const auto &p) {
-                                      const auto &[rect, i, j] = p;
-                                      return std::make_tuple(cv::sum(mask(rect))[0], i, j);
-                                  });
-
-                    auto [sum, x, y] =
-                            *ranges::max_element(sums, std::less<>(), [](const auto &p) { return std::get<0>(p); });
-                    res = mandelbrot_set_.colorize(mat);
-
-                    center = cv::Point2d(l + x * w + w / 2, t + y * h + h / 2);
-                    if (show_grid_) {
-                        printGrid(res, l, r, t, b, w, h, center);
+            // The render share is split between the keyframes in flight, and they are sent on in order.
+            const auto concurrency = std::min<size_t>(KEYFRAME_CONCURRENCY, budget_.share(Stage::Render));
+            exec::static_thread_pool render_pool(static_cast<uint32_t>(concurrency));
+            if (Numa::pinning()) {
+                pinRenderPool(render_pool, static_cast<unsigned int>(concurrency));
+            }
+            for (size_t batch = 0; batch < plan.size(); batch += concurrency) {
+                const auto count = std::min(concurrency, plan.size() - batch);
+                std::vector<RenderedKeyframe> rendered(count);
+                if (journal_) {
+                    for (size_t i = 0; i < count; ++i) {
+                        journal_->addKeyframe(static_cast<int>(first_step + batch + i), plan[batch + i].center);
                     }
-
-                    // Update the center for the next iteration.
-                    auto xmin = mandelbrot_set_.getXMin(), xmax = mandelbrot_set_.getXMax();
-                    auto ymin = mandelbrot_set_.getYMin(), ymax = mandelbrot_set_.getYMax();
-                    center_.x = xmin + center.x * (xmax - xmin) / res.cols;
-                    center_.y = ymin + center.y * (ymax - ymin) / res.rows;
-
-                } else {
-                    res = mandelbrot_set_.generate();
                 }
+                ex::sync_wait(ex::schedule(render_pool.get_scheduler()) | ex::bulk(count, [&](size_t i) {
+                                  const auto keyframe_index = static_cast<int>(first_step + batch + i);
+                                  rendered[i] = renderKeyframe(plan[batch + i], keyframe_index,
+                                                               static_cast<unsigned int>(concurrency));
+                              }));
 
-                println(stdout, "Keyframes generated on thread {} at {}s", std::this_thread::get_id(),
-                        TIME_DIFF(start_));
-
-                // Call the interpolation function.
-                channel_.send(std::make_pair(res, center));
-
-                // Call the image write function.
-                scope.spawn(ex::starts_on(io_pool_.get_scheduler(),
-                                          ex::just(std::make_pair(std::move(res), step)) |
-                                                  ex::then([this](auto &&arg) { this->imageWrite(arg); })));
+                for (size_t i = 0; i < count; ++i) {
+                    const auto keyframe_index = static_cast<int>(first_step + batch + i);
+                    auto &[mat, res, stats] = rendered[i];
+                    println(stdout, "Keyframe {} generated at {}s, {:.1f} iterations per pixel, {:.1f}% interior",
+                            keyframe_index, TIME_DIFF(start_), stats.meanIterations(),
+                            100.0 * stats.interior / stats.pixels());
+
+                    // Call the interpolation function.
+                    channel_.send(std::make_pair(res, plan[batch + i].target.center));
+
+                    // Call the image write function. The raw matrix is only kept alive if it is what we write.
+                    if (write_keyframes_) {
+                        auto keyframe = Keyframe{std::move(res),
+                                                 image_format_ == ImageFormat::RawCounts ? std::move(mat) : cv::Mat(),
+                                                 keyframe_index};
+                        scope.spawn(ex::starts_on(io_pool_->get_scheduler(),
+                                                  ex::just(std::move(keyframe)) | ex::then([this](Keyframe &&arg) {
+                                                      this->imageWrite(arg);
+                                                  })));
+                    }
+                }
             }
 
             done_.request_stop();
             ex::sync_wait(scope.on_empty());
+            if (journal_) {
+                concatenateSegments();
+            }
             println(stdout, "All work done on thread {} at {}s", std::this_thread::get_id(), TIME_DIFF(start_));
+            budget_.report(stdout);
         }
 
     private:
-        static void printGrid(cv::Mat &image, int l, int r, int t, int b, int w, int h, cv::Point2d center) {
-            cv::line(image, cv::Point(0, t), cv::Point(image.cols, t), cv::Scalar(0, 255, 0), 2);
-            cv::line(image, cv::Point(0, b), cv::Point(image.cols, b), cv::Scalar(0, 255, 0), 2);
-            cv::line(image, cv::Point(l, 0), cv::Point(l, image.rows), cv::Scalar(0, 255, 0), 2);
-            cv::line(image, cv::Point(r, 0), cv::Point(r, image.rows), cv::Scalar(0, 255, 0), 2);
+        /**
+         * @brief A keyframe queued for writing.
+         */
+        struct Keyframe {
+            cv::Mat image;
+            cv::Mat raw;
+            int step;
+        };
 
-            for (auto k: views::iota(1, BLOCK_SIZE)) {
-                cv::line(image, cv::Point(l + k * w, t), cv::Point(l + k * w, b), cv::Scalar(0, 255, 0), 2);
-                cv::line(image, cv::Point(l, t + k * h), cv::Point(r, t + k * h), cv::Scalar(0, 255, 0), 2);
+        /**
+         * @brief A keyframe of the planned trajectory.
+         */
+        struct Waypoint {
+            PointType center; ///< The center of the keyframe in the complex plane.
+            double factor; ///< The zoom of the keyframe relative to the initial size.
+            ZoomTarget target; ///< The center of the next keyframe, in the pixel coordinates of this one.
+        };
+
+        /**
+         * @brief A rendered and colorized keyframe.
+         */
+        struct RenderedKeyframe {
+            cv::Mat raw;
+            cv::Mat image;
+            RenderStats stats;
+        };
+
+        /**
+         * @brief Fix the center of every keyframe from first_step on.
+         * @note With auto-detect, the zoom target of every keyframe is searched on a scout render of 1 / SCOUT_DIVISOR
+         *       of the resolution. The scouts cost about 1 / SCOUT_DIVISOR^2 of the keyframes, and none of the
+         *       keyframes depends on another one any more. With a nucleus, only the first keyframe is scouted.
+         */
+        std::vector<Waypoint> planTrajectory(size_t first_step) {
+            const auto width = mandelbrot_set_.getWidth(), height = mandelbrot_set_.getHeight();
+            const auto screen_center = PointType(width / 2.0, height / 2.0);
+            auto factor = 1.0;
+            for (size_t i = 0; i < first_step; ++i) {
+                factor *= zoom_factor_;
+            }
+
+            std::vector<Waypoint> plan;
+            // A resumed render keeps aiming at the nucleus of the first run, so it needs no scouts at all.
+            if (const auto aim = recordedNucleus(); auto_detect_ && nucleus_ && aim && first_step < max_step_) {
+                const auto xsize = xsize_ / factor, ysize = ysize_ / factor;
+                const auto target = PointType((aim->x - center_.x + xsize / 2) / xsize * width,
+                                              (aim->y - center_.y + ysize / 2) / ysize * height);
+                plan.push_back(Waypoint{center_, factor, ZoomTarget{target, {}}});
+                for (auto step = first_step + 1; step < max_step_; ++step) {
+                    factor *= zoom_factor_;
+                    plan.push_back(Waypoint{*aim, factor, ZoomTarget{screen_center, {}}});
+                }
+                return plan;
+            }
+            if (!auto_detect_) {
+                for (size_t step = first_step; step < max_step_; ++step) {
+                    plan.push_back(Waypoint{center_, factor, ZoomTarget{screen_center, {}}});
+                    factor *= zoom_factor_;
+                }
+                return plan;
             }
 
-            cv::line(image, cv::Point(0, center.y), cv::Point(image.cols, center.y), cv::Scalar(0, 0, 255), 2);
-            cv::line(image, cv::Point(center.x, 0), cv::Point(center.x, image.rows), cv::Scalar(0, 0, 255), 2);
-            cv::circle(image, center, 30, cv::Scalar(0, 0, 255), 2);
+            auto scout = mandelbrot_set_;
+            scout.setResolution(std::max<size_t>(1, width / SCOUT_DIVISOR),
+                                std::max<size_t>(1, height / SCOUT_DIVISOR));
+            const auto scale_x = static_cast<double>(width) / scout.getWidth();
+            const auto scale_y = static_cast<double>(height) / scout.getHeight();
+            auto center = center_;
+            for (size_t step = first_step; step < max_step_; ++step) {
+                const auto keyframe_index = static_cast<int>(step);
+                scout.setCenter(center.x, center.y, xsize_ / factor, ysize_ / factor);
+                cv::Mat mat;
+                {
+                    MANDELBROT_TRACE_SCOPE("scout", keyframe_index);
+                    ThreadBudget::TeamScope budget_scope(budget_, Stage::Render);
+                    mat = scout.generateRawMatrix();
+                }
+
+                // Only search the central part of the image, so that the next keyframe stays on the screen.
+                const auto window = cv::Rect(mat.cols / DIVIDE * (DIVIDE / 2), mat.rows / DIVIDE * (DIVIDE / 2),
+                                             mat.cols / DIVIDE, mat.rows / DIVIDE);
+                const auto target = [&] {
+                    MANDELBROT_TRACE_SCOPE("autoDetect", keyframe_index);
+                    Perf::Scope perf_scope("autoDetect");
+                    ThreadBudget::Scope budget_scope(budget_, Stage::Render);
+                    return findZoomTarget(boundaryIntegral(mat), window, std::max(1, MIN_TARGET_SIZE / SCOUT_DIVISOR));
+                }();
+
+                // The grid and the target are drawn on the keyframe, so they are scaled to its resolution.
+                ZoomTarget keyframe_target{PointType(target.center.x * scale_x, target.center.y * scale_y), {}};
+                for (const auto &cell: target.path) {
+                    keyframe_target.path.emplace_back(cvRound(cell.x * scale_x), cvRound(cell.y * scale_y),
+                                                      cvRound(cell.width * scale_x), cvRound(cell.height * scale_y));
+                }
+                plan.push_back(Waypoint{center, factor, std::move(keyframe_target)});
+
+                // With a nucleus, the rest of the trajectory is a straight zoom into it and needs no more scouts.
+                if (nucleus_ && step == first_step) {
+                    if (const auto aim = aimAtNucleus(scout, mat, target.center, window, factor, step)) {
+                        plan.back().target.center = PointType(
+                                (aim->x - scout.getXMin()) / (scout.getXMax() - scout.getXMin()) * width,
+                                (aim->y - scout.getYMin()) / (scout.getYMax() - scout.getYMin()) * height);
+                        for (auto next = step + 1; next < max_step_; ++next) {
+                            factor *= zoom_factor_;
+                            plan.push_back(Waypoint{*aim, factor, ZoomTarget{screen_center, {}}});
+                        }
+                        return plan;
+                    }
+                }
+
+                center.x = scout.getXMin() + target.center.x * (scout.getXMax() - scout.getXMin()) / mat.cols;
+                center.y = scout.getYMin() + target.center.y * (scout.getYMax() - scout.getYMin()) / mat.rows;
+                factor *= zoom_factor_;
+            }
+            return plan;
+        }
+
+        /**
+         * @brief Locate a nucleus near the zoom target of a scout render.
+         * @param target The zoom target in the pixel coordinates of the scout render.
+         * @param window The search window of the target. The nucleus must lie about inside it.
+         * @param factor The zoom factor of keyframe step, the view of the scout render.
+         * @return The nucleus, or std::nullopt if none was found.
+         */
+        std::optional<PointType> aimAtNucleus(const MandelbrotSetImpl &scout, const cv::Mat &mat,
+                                              const PointType &target, const cv::Rect &window, double factor,
+                                              size_t step) {
+            MANDELBROT_TRACE_SCOPE("nucleus", static_cast<int>(step));
+            Perf::Scope perf_scope("nucleus");
+            const auto pixel = static_cast<long double>(scout.getXMax() - scout.getXMin()) / mat.cols;
+            const ComplexLD point(scout.getXMin() + target.x * pixel,
+                                  scout.getYMin() + target.y * (scout.getYMax() - scout.getYMin()) / mat.rows);
+            const auto deepest = factor * std::pow(zoom_factor_, static_cast<double>(max_step_ - 1 - step));
+            const auto nucleus = findNucleus(point, xsize_ / deepest / 2, window.width * pixel / 2);
+            if (!nucleus) {
+                println(stdout, "No nucleus near the zoom target, following the boundary");
+                return std::nullopt;
+            }
+            println(stdout, "Nucleus of period {} at {}, {} with size {:.3g}", nucleus->period,
+                    static_cast<double>(nucleus->c.real()), static_cast<double>(nucleus->c.imag()),
+                    static_cast<double>(nucleus->size));
+            if (journal_) {
+                journal_->addSetting(std::string(NUCLEUS_SETTING), std::format("{} {} {}", nucleus->c.real(),
+                                                                                nucleus->c.imag(), nucleus->period));
+            }
+            return PointType(static_cast<double>(nucleus->c.real()), static_cast<double>(nucleus->c.imag()));
+        }
+
+        /**
+         * @brief The nucleus that the journal of a resumed render aims at, or std::nullopt if there is none.
+         */
+        [[nodiscard]] std::optional<PointType> recordedNucleus() const {
+            if (!journal_) {
+                return std::nullopt;
+            }
+            const auto it = journal_->getSettings().find(NUCLEUS_SETTING);
+            if (it == journal_->getSettings().end()) {
+                return std::nullopt;
+            }
+            std::istringstream stream(it->second);
+            long double real = 0, imag = 0;
+            if (!(stream >> real >> imag)) {
+                return std::nullopt;
+            }
+            return PointType(static_cast<double>(real), static_cast<double>(imag));
+        }
+
+        /**
+         * @brief Render and colorize a keyframe of the trajectory.
+         * @param parts The keyframes rendered at once, which split the render share.
+         * @note Called from the threads of the render pool. The view is a copy, so the keyframes do not share state.
+         */
+        RenderedKeyframe renderKeyframe(const Waypoint &waypoint, int keyframe_index, unsigned int parts) const {
+            budget_.limitOpenMP(Stage::Render, parts);
+            auto view = mandelbrot_set_;
+            view.setCenter(waypoint.center.x, waypoint.center.y, xsize_ / waypoint.factor, ysize_ / waypoint.factor);
+
+            RenderedKeyframe keyframe;
+            {
+                MANDELBROT_TRACE_SCOPE("render", keyframe_index);
+                ThreadBudget::TeamScope budget_scope(budget_, Stage::Render);
+                keyframe.raw = view.generateRawMatrix(keyframe.stats);
+            }
+            keyframe.image = colorize(keyframe.raw, keyframe_index);
+            if (auto_detect_ && show_grid_) {
+                printGrid(keyframe.image, waypoint.target);
+            }
+            return keyframe;
+        }
+
+        /**
+         * @brief Pin every worker of the keyframe render pool and the OpenMP team it renders with to one node.
+         * @note The keyframes are rendered and colorized by these teams, so they first-touch the keyframe buffers.
+         */
+        void pinRenderPool(exec::static_thread_pool &pool, unsigned int thread_count) const {
+            onEveryThread(pool.get_scheduler(), thread_count, [this, thread_count](size_t i) {
+                Numa::pinCurrentThread(Numa::threadCpus(i, thread_count));
+                budget_.limitOpenMP(Stage::Render, thread_count);
+                Numa::pinOpenMPTeam();
+            });
+        }
+
+        /**
+         * @brief Pin every thread of a pool to its NUMA node.
+         * @note The threads are spread evenly over the nodes, so a bulk over the frames warps every frame on the node
+         *       of the thread that runs it, whichever that is.
+         */
+        static void pinPool(exec::static_thread_pool &pool, unsigned int thread_count) {
+            onEveryThread(pool.get_scheduler(), thread_count, [thread_count](size_t i) {
+                Numa::pinCurrentThread(Numa::threadCpus(i, thread_count));
+            });
+        }
+
+        /**
+         * @brief The settings that a resumed render must share with the journal.
+         */
+        [[nodiscard]] RenderJournal::Settings journalSettings() const {
+            RenderJournal::Settings settings{
+                    {"resolution", std::format("{}x{}", mandelbrot_set_.getWidth(), mandelbrot_set_.getHeight())},
+                    {"center", std::format("{} {}", center_.x, center_.y)},
+                    {"size", std::format("{} {}", xsize_, ysize_)},
+                    {"zoom_factor", std::format("{}", zoom_factor_)},
+                    {"scale_rate", std::format("{}", scale_rate_)},
+                    {"max_step", std::format("{}", max_step_)},
+                    {"auto_detect", std::format("{}", auto_detect_)},
+                    {"show_grid", std::format("{}", show_grid_)},
+                    {"interpolation", std::format("{}", static_cast<int>(interpolation_mode_))},
+                    {"format", std::format("{}", static_cast<int>(video_format_))},
+                    {"fps", std::format("{}", fps_)},
+            };
+            if (color_seed_) {
+                settings["colors"] = std::format("{}", *color_seed_);
+            }
+            if (yuv_) {
+                settings["yuv"] = "true";
+            }
+            if (nucleus_) {
+                settings["nucleus"] = "true";
+            }
+            return settings;
+        }
+
+        /**
+         * @brief Open the journal of the checkpoint directory, if any.
+         * @return The first keyframe to render. The keyframes before it are done.
+         */
+        size_t openJournal() {
+            journal_.reset();
+            if (checkpoint_directory_.empty()) {
+                return 0;
+            }
+            journal_.emplace(checkpoint_directory_);
+            const auto settings = journalSettings();
+            if (!resume_ || !journal_->load()) {
+                journal_->create(settings);
+                return 0;
+            }
+
+            if (const auto key = journal_->mismatch(settings, {"colors"})) {
+                throw std::runtime_error(
+                        std::format("The checkpoint in {} has a different {}", checkpoint_directory_, *key));
+            }
+            if (const auto it = journal_->getSettings().find("colors");
+                it != journal_->getSettings().end() && color_seed_) {
+                setColorSeed(static_cast<uint32_t>(std::stoul(it->second)));
+            }
+
+            size_t step = 0;
+            while (step < max_step_ && journal_->hasSegment(static_cast<int>(step)) &&
+                   (!write_keyframes_ || journal_->hasImage(static_cast<int>(step)))) {
+                ++step;
+            }
+            // The trajectory continues from the recorded center of the keyframe.
+            while (step > 0 && step < max_step_ && !journal_->center(static_cast<int>(step))) {
+                --step;
+            }
+            if (const auto center = journal_->center(static_cast<int>(step))) {
+                center_ = *center;
+            }
+            return step;
+        }
+
+        [[nodiscard]] std::string segmentExtension() const {
+            return std::filesystem::path(video_name_).extension().string();
+        }
+
+        void concatenateSegments() {
+            std::vector<std::filesystem::path> segments;
+            for (size_t i = 0; i < max_step_; ++i) {
+                segments.push_back(journal_->segmentPath(static_cast<int>(i), segmentExtension()));
+            }
+            println(stdout, "Concatenating {} segments into {}", segments.size(), video_name_);
+            if (!concatenateVideos(video_format_, segments, video_name_,
+                                   cv::Size(mandelbrot_set_.getWidth(), mandelbrot_set_.getHeight()), fps_)) {
+                println(stderr, "Some segments in {} are missing", checkpoint_directory_);
+            }
+        }
+
+        void printGrid(cv::Mat &image, const ZoomTarget &target) const {
+            // An I420 keyframe only gets the grid in its Y plane, so it is drawn in white.
+            auto canvas = yuv_ ? i420Planes(image)[0] : image;
+            const auto cell_color = yuv_ ? cv::Scalar(235) : cv::Scalar(0, 255, 0);
+            const auto target_color = yuv_ ? cv::Scalar(235) : cv::Scalar(0, 0, 255);
+            for (const auto &cell: target.path) {
+                cv::rectangle(canvas, cell, cell_color, 2);
+            }
+
+            const auto center = target.center;
+            cv::line(canvas, cv::Point(0, center.y), cv::Point(canvas.cols, center.y), target_color, 2);
+            cv::line(canvas, cv::Point(center.x, 0), cv::Point(center.x, canvas.rows), target_color, 2);
+            cv::circle(canvas, center, 30, target_color, 2);
+        }
+
+        cv::Mat colorize(const cv::Mat &mat, int keyframe) const {
+            MANDELBROT_TRACE_SCOPE("colorize", keyframe);
+            Perf::Scope perf_scope("colorize");
+            // Colorize only uses the whole render team with NUMA pinning, see BaseMandelbrotSet::colorize.
+            ThreadBudget::TeamScope budget_scope(budget_, Stage::Render);
+            return yuv_ ? mandelbrot_set_.colorizeI420(mat) : mandelbrot_set_.colorize(mat);
+        }
+
+        /**
+         * @brief The planes of a frame: the Y, U and V planes of an I420 frame, or the BGR frame itself.
+         */
+        [[nodiscard]] std::vector<cv::Mat> planes(const cv::Mat &frame) const {
+            if (!yuv_) {
+                return {frame};
+            }
+            const auto yuv = i420Planes(frame);
+            return {yuv.begin(), yuv.end()};
         }
 
         void computeTransformMatrices(const cv::Point2f &center, double scale_rate, int frames) {
@@ -278,50 +756,196 @@ namespace Mandelbrot {
         }
 
         exec::task<void> interpolateFrames() {
-            cv::VideoWriter writer;
-            ScopeGuard guard{[&]() { writer.release(); }};
-            writer.open(video_name_, cv::VideoWriter::fourcc('h', 'v', 'c', 'l'), 30,
-                        cv::Size(mandelbrot_set_.getWidth(), mandelbrot_set_.getHeight()), true);
+            // With a checkpoint, every segment opens a sink of its own.
+            auto sink = journal_ ? nullptr
+                                 : makeFrameSink(video_format_, video_name_,
+                                                 cv::Size(mandelbrot_set_.getWidth(), mandelbrot_set_.getHeight()),
+                                                 fps_);
+
+            // In bidirectional mode a keyframe can only be interpolated once the next one has arrived.
+            std::optional<std::pair<cv::Mat, PointType>> pending;
 
             while (!done_.stop_requested() || !channel_.empty()) {
                 auto value = co_await channel_.receive();
                 if (value) {
-                    auto [image, center] = value.value();
-                    computeTransformMatrices(center, scale_rate_, frame_count_);
-
-                    println(stdout, "Generating with center: ({}, {}) on thread {} at {}s", center.x, center.y,
-                            std::this_thread::get_id(), TIME_DIFF(start_));
-
-                    co_await ( //
-                            ex::schedule(compute_pool_.get_scheduler()) //
-                            | ex::bulk(frame_count_, [&](int i) {
-                                  cv::warpAffine(image, frames_[i], transform_matrices_[i],
-                                                 cv::Size(mandelbrot_set_.getWidth(), mandelbrot_set_.getHeight()));
-                              }));
-
-                    // Write the frames to the video.
-                    // This has to be synchronous, otherwise the frames will be out of order.
-                    for (auto &frame: frames_) {
-                        writer.write(frame);
+                    if (interpolation_mode_ == InterpolationMode::Forward) {
+                        co_await interpolateSegment(sink.get(), value->first, value->second, nullptr);
+                    } else {
+                        if (pending) {
+                            co_await interpolateSegment(sink.get(), pending->first, pending->second, &value->first);
+                        }
+                        pending = std::move(value);
                     }
-                    println(stdout, "Video generated on thread {} at {}s", std::this_thread::get_id(),
-                            TIME_DIFF(start_));
                     co_await ex::just();
                 } else {
                     co_await ex::just();
                 }
             }
+
+            // The last keyframe has no successor to blend with.
+            if (pending) {
+                co_await interpolateSegment(sink.get(), pending->first, pending->second, nullptr);
+            }
+        }
+
+        /**
+         * @brief Generate and write the intermediate frames between a keyframe and the next one.
+         * @param sink The frame sink, or nullptr to write the segment to its file in the checkpoint directory.
+         * @param image The keyframe to zoom in.
+         * @param center The zoom target in the pixel coordinates of the keyframe.
+         * @param next The next keyframe to blend in, or nullptr to zoom the current keyframe only.
+         */
+        exec::task<void> interpolateSegment(FrameSink *sink, const cv::Mat &image, PointType center,
+                                            const cv::Mat *next) {
+            const auto keyframe = segment_++;
+            computeTransformMatrices(center, scale_rate_, frame_count_);
+
+            // The frames have to be allocated before the bands are filled concurrently.
+            const auto size = cv::Size(mandelbrot_set_.getWidth(), mandelbrot_set_.getHeight());
+            for (auto &frame: frames_) {
+                frame.create(image.size(), image.type());
+            }
+            if (next) {
+                computeBlendTransforms(center);
+                for (auto &frame: blend_frames_) {
+                    frame.create(image.size(), image.type());
+                }
+            }
+
+            co_await ( //
+                    ex::schedule(compute_pool_->get_scheduler()) //
+                    | ex::bulk(frame_count_ * ZOOM_BANDS, [&](size_t k) {
+                          const auto i = k / ZOOM_BANDS, band = k % ZOOM_BANDS;
+                          MANDELBROT_TRACE_SCOPE("warp", keyframe, static_cast<int32_t>(i));
+                          Perf::Scope perf_scope("warp");
+                          ThreadBudget::Scope budget_scope(budget_, Stage::Warp);
+                          // Every plane is split into the same bands, the chroma planes with half the rows.
+                          const auto sources = planes(image);
+                          auto targets = planes(frames_[i]);
+                          for (size_t p = 0; p < targets.size(); ++p) {
+                              const auto rows = targets[p].rows;
+                              const auto row_begin = static_cast<int>(rows * band / ZOOM_BANDS);
+                              const auto row_end = static_cast<int>(rows * (band + 1) / ZOOM_BANDS);
+                              const auto transform =
+                                      p == 0 ? transform_matrices_[i] : chromaTransform(transform_matrices_[i]);
+                              zoomAffine(sources[p], targets[p], transform, row_begin, row_end);
+                              if (next) {
+                                  auto blend_target = planes(blend_frames_[i])[p];
+                                  const auto blend_transform =
+                                          p == 0 ? blend_matrices_[i] : chromaTransform(blend_matrices_[i]);
+                                  blendBand(planes(*next)[p], targets[p], blend_target, blend_transform,
+                                            static_cast<double>(i) / frame_count_, row_begin, row_end);
+                              }
+                          }
+                      }));
+
+            // A segment file only counts as done once it is closed.
+            std::unique_ptr<FrameSink> segment_sink;
+            if (!sink) {
+                const auto path = journal_->segmentPath(keyframe, segmentExtension());
+                segment_sink = makeFrameSink(video_format_, path.string(), size, fps_);
+                sink = segment_sink.get();
+            }
+
+            // Write the frames to the video.
+            // This has to be synchronous, otherwise the frames will be out of order.
+            for (size_t i = 0; i < frames_.size(); ++i) {
+                MANDELBROT_TRACE_SCOPE("encode", keyframe, static_cast<int32_t>(i));
+                Perf::Scope perf_scope("encode");
+                ThreadBudget::Scope budget_scope(budget_, Stage::Encode);
+                sink->write(frames_[i]);
+            }
+
+            if (segment_sink) {
+                segment_sink.reset();
+                journal_->addSegment(keyframe);
+            }
         }
 
-        void imageWrite(std::pair<cv::Mat, int> &&arg) {
-            println(stdout, "Writing image on thread {} at {}s", std::this_thread::get_id(), TIME_DIFF(start_));
+        /**
+         * @brief Compute the transforms that place the next keyframe into every intermediate frame.
+         * @param center The zoom target in the pixel coordinates of the current keyframe.
+         * @note The next keyframe is the current one zoomed in by zoom_factor_ around center, so frame i shows it
+         *       scaled down by scale_rate_^i / zoom_factor_.
+         */
+        void computeBlendTransforms(const PointType &center) {
+            const auto absolute_center =
+                    PointType(mandelbrot_set_.getWidth() / 2.0, mandelbrot_set_.getHeight() / 2.0);
+            for (size_t i = 0; i < frame_count_; ++i) {
+                auto &transform = blend_matrices_[i];
+                transform = transform_matrices_[i].clone();
+                const auto factor = transform.at<double>(0, 0);
+                const auto ratio = factor / zoom_factor_;
+                transform.at<double>(0, 0) = transform.at<double>(1, 1) = ratio;
+                transform.at<double>(0, 2) += factor * center.x - ratio * absolute_center.x;
+                transform.at<double>(1, 2) += factor * center.y - ratio * absolute_center.y;
+            }
+        }
+
+        /**
+         * @brief Blend a plane of the next keyframe into the rows [row_begin, row_end) of the same plane of a frame.
+         * @param next The plane of the next keyframe.
+         * @param frame The plane of the frame.
+         * @param blend_frame The plane of the blend buffer of the frame.
+         * @param transform The blend transform of the plane.
+         * @param weight The weight of the next keyframe.
+         * @note The weight of the next keyframe grows linearly with the position of the frame in the segment. Pixels
+         *       that the next keyframe does not cover keep the zoomed current keyframe.
+         */
+        static void blendBand(const cv::Mat &next, cv::Mat &frame, cv::Mat &blend_frame, const cv::Mat &transform,
+                              double weight, int row_begin, int row_end) {
+            const auto ratio = transform.at<double>(0, 0);
+            const auto shift_x = transform.at<double>(0, 2), shift_y = transform.at<double>(1, 2);
+
+            // Only the pixels whose bilinear taps are all inside the next keyframe, so the border never bleeds in.
+            const auto left = std::max(0, static_cast<int>(std::ceil(shift_x)));
+            const auto right =
+                    std::min(frame.cols, static_cast<int>(std::floor(ratio * (next.cols - 1) + shift_x)) + 1);
+            const auto top = std::max(row_begin, static_cast<int>(std::ceil(shift_y)));
+            const auto bottom =
+                    std::min(row_end, static_cast<int>(std::floor(ratio * (next.rows - 1) + shift_y)) + 1);
+            if (left >= right || top >= bottom) {
+                return;
+            }
 
-            auto &[image, step] = arg;
-            auto filename = std::format(frame_basename_, step + 1);
-            cv::imwrite(filename, image);
+            zoomAffine(next, blend_frame, transform, top, bottom);
+            const auto roi = cv::Rect(left, top, right - left, bottom - top);
+            cv::Mat target = frame(roi);
+            cv::addWeighted(target, 1.0 - weight, blend_frame(roi), weight, 0, target);
+        }
 
-            println(stdout, "Image {} written on thread {} at {}s", filename, std::this_thread::get_id(),
-                    TIME_DIFF(start_));
+        void imageWrite(const Keyframe &keyframe) {
+            MANDELBROT_TRACE_SCOPE("imageWrite", keyframe.step);
+            Perf::Scope perf_scope("imageWrite");
+            ThreadBudget::Scope budget_scope(budget_, Stage::ImageWrite);
+
+            const auto filename = (std::filesystem::path(keyframe_directory_) /
+                                   std::format("MandelbrotSetKeyFrame{}.{}", keyframe.step + 1,
+                                               imageExtension(image_format_)))
+                                          .string();
+            // The image writers take BGR, so an I420 keyframe is converted here, off the render and warp threads.
+            cv::Mat image = keyframe.image;
+            if (yuv_ && !image.empty()) {
+                cv::cvtColor(keyframe.image, image, cv::COLOR_YUV2BGR_I420);
+            }
+            bool written = false;
+            switch (image_format_) {
+                case ImageFormat::QOI:
+                    written = writeQOI(filename, image);
+                    break;
+                case ImageFormat::RawCounts:
+                    written = writeRawCounts(filename, keyframe.raw);
+                    break;
+                case ImageFormat::PNG:
+                default:
+                    written = writePNG(filename, image, png_compression_);
+                    break;
+            }
+            if (!written) {
+                println(stderr, "Failed to write image {}", filename);
+            } else if (journal_) {
+                journal_->addImage(keyframe.step);
+            }
         };
 
         // Settings for video generation
@@ -334,19 +958,35 @@ namespace Mandelbrot {
         size_t max_step_{10};
         bool auto_detect_{false};
         bool show_grid_{false};
+        bool nucleus_{false};
+        InterpolationMode interpolation_mode_{InterpolationMode::Forward};
         std::string video_name_{"MandelbrotSet.mp4"};
-
-        // TODO: Currently the frame basename is hardcoded. We need to make it configurable.
-        constexpr static auto frame_basename_ = "frames/MandelbrotSetKeyFrame{}.png";
+        VideoFormat video_format_{VideoFormat::Encoded};
+        bool yuv_{false};
+        double fps_{30.0};
+        std::optional<uint32_t> color_seed_{};
+
+        // Settings for checkpoints
+        std::string checkpoint_directory_{};
+        bool resume_{false};
+        std::optional<RenderJournal> journal_{};
+
+        // Settings for keyframe images
+        bool write_keyframes_{true};
+        std::string keyframe_directory_{"frames"};
+        ImageFormat image_format_{ImageFormat::PNG};
+        int png_compression_{-1};
 
         // Async settings and buffers
-        unsigned int worker_count_{std::thread::hardware_concurrency() / 4 + 1};
-        unsigned int io_count_{std::thread::hardware_concurrency() / 2 + 1};
+        ThreadBudget budget_{};
         std::stop_source done_{};
-        exec::static_thread_pool compute_pool_{worker_count_};
-        exec::static_thread_pool io_pool_{io_count_};
+        int segment_{0};
+        std::optional<exec::static_thread_pool> compute_pool_{};
+        std::optional<exec::static_thread_pool> io_pool_{};
         std::vector<cv::Mat> transform_matrices_{};
         std::vector<cv::Mat> frames_{};
+        std::vector<cv::Mat> blend_matrices_{};
+        std::vector<cv::Mat> blend_frames_{};
         MandelbrotSetImpl mandelbrot_set_{};
         AsyncChannel<std::pair<cv::Mat, PointType>> channel_{};
 
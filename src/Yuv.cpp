@@ -0,0 +1,53 @@
+#include "Yuv.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Mandelbrot {
+    namespace {
+        uchar clampByte(double value) { return static_cast<uchar>(std::clamp(std::lround(value), 0l, 255l)); }
+    } // namespace
+
+    cv::Vec3b bgrToYuv(const cv::Vec3b &bgr) {
+        const double b = bgr[0], g = bgr[1], r = bgr[2];
+        return {clampByte(16.0 + 0.257 * r + 0.504 * g + 0.098 * b),
+                clampByte(128.0 - 0.148 * r - 0.291 * g + 0.439 * b),
+                clampByte(128.0 + 0.439 * r - 0.368 * g - 0.071 * b)};
+    }
+
+    std::vector<cv::Vec3b> yuvPalette(std::span<const cv::Vec3b> colors) {
+        std::vector<cv::Vec3b> palette(colors.size());
+        std::ranges::transform(colors, palette.begin(), bgrToYuv);
+        return palette;
+    }
+
+    cv::Size i420Size(cv::Size size) {
+        CV_Assert(size.width % 2 == 0 && size.height % 2 == 0);
+        return {size.width, size.height * 3 / 2};
+    }
+
+    bool isI420(const cv::Mat &frame, cv::Size size) {
+        return frame.type() == CV_8UC1 && size.width % 2 == 0 && size.height % 2 == 0 && frame.size() == i420Size(size);
+    }
+
+    std::array<cv::Mat, 3> i420Planes(const cv::Mat &frame) {
+        CV_Assert(frame.type() == CV_8UC1 && frame.isContinuous() && frame.rows % 3 == 0 && frame.cols % 2 == 0);
+        const auto width = frame.cols, height = frame.rows * 2 / 3;
+        // A chroma plane may end in the middle of a row of the frame, so the planes are headers at byte offsets.
+        auto *data = const_cast<uchar *>(frame.data);
+        const auto chroma_bytes = static_cast<size_t>(width / 2) * (height / 2);
+        auto *u = data + static_cast<size_t>(width) * height;
+        return {cv::Mat(height, width, CV_8UC1, data), cv::Mat(height / 2, width / 2, CV_8UC1, u),
+                cv::Mat(height / 2, width / 2, CV_8UC1, u + chroma_bytes)};
+    }
+
+    cv::Mat chromaTransform(const cv::Mat &transform) {
+        // Chroma sample c sits at pixel 2c + 0.5, so x' = s x + t turns into c' = s c + (t + (s - 1) / 2) / 2.
+        cv::Mat chroma = transform.clone();
+        for (int row = 0; row < 2; ++row) {
+            const auto scale = transform.at<double>(row, row);
+            chroma.at<double>(row, 2) = (transform.at<double>(row, 2) + 0.5 * (scale - 1.0)) / 2.0;
+        }
+        return chroma;
+    }
+
+} // namespace Mandelbrot
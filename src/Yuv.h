@@ -0,0 +1,60 @@
+#ifndef MANDELBROTSET_SRC_YUV_H
+#define MANDELBROTSET_SRC_YUV_H
+
+/**
+ * @file Yuv.h
+ * @brief Video frames in planar YUV 4:2:0.
+ *
+ * An I420 frame of a W x H image is a single CV_8UC1 buffer of W x 3H/2 bytes, as cv::cvtColor produces it: the full
+ * resolution Y plane, followed by the U and the V plane of W/2 x H/2 samples each. Every chroma sample covers a 2x2
+ * block of pixels and sits at its center, which is the C420jpeg siting of the Y4M stream. The colors are BT.601 with
+ * the limited range, the same as cv::COLOR_BGR2YUV_I420.
+ *
+ * A frame that is colorized and warped in I420 moves half the bytes of a BGR frame through every stage, and the Y4M
+ * sink writes it without a conversion.
+ */
+
+#include <array>
+#include <opencv2/core.hpp>
+#include <span>
+#include <vector>
+
+namespace Mandelbrot {
+
+    /**
+     * @brief Convert a BGR color to YUV, in the order Y, U, V.
+     */
+    cv::Vec3b bgrToYuv(const cv::Vec3b &bgr);
+
+    /**
+     * @brief Convert every color of a palette to YUV.
+     */
+    std::vector<cv::Vec3b> yuvPalette(std::span<const cv::Vec3b> colors);
+
+    /**
+     * @brief The size of the I420 frame of an image.
+     * @param size The image size. Both sides must be even.
+     */
+    cv::Size i420Size(cv::Size size);
+
+    /**
+     * @brief Whether a frame is the I420 frame of an image of the given size.
+     */
+    bool isI420(const cv::Mat &frame, cv::Size size);
+
+    /**
+     * @brief The Y, U and V planes of an I420 frame.
+     * @return The headers of the planes. They share the data of the frame, like any other cv::Mat header.
+     */
+    std::array<cv::Mat, 3> i420Planes(const cv::Mat &frame);
+
+    /**
+     * @brief The transform of the chroma planes for a zoom transform of the Y plane.
+     * @param transform The zoom transform in the pixel coordinates of the Y plane, in the form cv::warpAffine expects.
+     * @return The same zoom in the sample coordinates of the chroma planes.
+     */
+    cv::Mat chromaTransform(const cv::Mat &transform);
+
+} // namespace Mandelbrot
+
+#endif // MANDELBROTSET_SRC_YUV_H
@@ -4,15 +4,35 @@
 
 #include <cassert>
 #include <chrono>
+#include <ctime>
+#include <exec/async_scope.hpp>
+#include <exec/static_thread_pool.hpp>
+#include <fstream>
 #include <iostream>
 #include <opencv2/core/utils/logger.hpp>
 #include <opencv2/imgcodecs.hpp>
 #include <queue>
+#include <random>
 #include <ranges>
 #include <thread>
+#include "AreaEstimator.h"
+#include "BatchRenderer.h"
+#include "Buddhabrot.h"
 #include "ColorSchemes.h"
+#include "Formula.h"
+#include "ImageWriter.h"
 #include "MandelbrotSet.h"
 #include "MandelbrotSetCuda.h"
+#include "MandelbrotSetSimd.h"
+#include "Numa.h"
+#include "PerfCounters.h"
+#include "RuntimeMandelbrotSet.h"
+#include "TileCoordinator.h"
+#include "TileServer.h"
+#include "TileStream.h"
+#include "ThreadBudget.h"
+#include "Trace.h"
+#include "Tuning.h"
 #include "VideoGenerator.h"
 
 using namespace cv;
@@ -31,18 +51,34 @@ struct CommandLineArguments {
     bool set_output;
     string output;
     bool auto_detect, show_grid;
+    bool nucleus;
+    bool bidirectional;
+    Mandelbrot::VideoFormat video_format;
+    bool yuv;
+    double fps;
+    string keyframe_dir;
+    Mandelbrot::ImageFormat keyframe_format;
+    int png_compression;
+    string trace;
+    bool perf_counters;
+    string batch;
+    int workers;
+    int serve_port;
+    Mandelbrot::FormulaKind formula;
+    double julia_real, julia_imag;
+    size_t buddhabrot_samples;
+    size_t area_samples;
+    string backend;
+    bool recalibrate;
+    bool autotune;
+    bool numa, huge_pages;
+    optional<Mandelbrot::ThreadBudget> threads;
+    string checkpoint;
+    bool resume;
 };
 
-#if ENABLE_CUDA
-using DefaultMandelbrotSet = Mandelbrot::MandelbrotSetCuda;
-constexpr std::string_view CURRENT_IMPLEMENTATION = "CUDA";
-#elif ENABLE_MPFR
-using DefaultMandelbrotSet = Mandelbrot::MandelbrotSetMPFR;
-constexpr std::string_view CURRENT_IMPLEMENTATION = "MPFR";
-#else
-using DefaultMandelbrotSet = Mandelbrot::MandelbrotSet;
-constexpr std::string_view CURRENT_IMPLEMENTATION = "Pure CPU";
-#endif
+// The backend is selected at startup, see RuntimeMandelbrotSet.h.
+using DefaultMandelbrotSet = Mandelbrot::RuntimeMandelbrotSet;
 
 #define MAND_ASSERT(cond)                                                                                              \
     do {                                                                                                               \
@@ -65,11 +101,45 @@ Options:
     --ymin <ymin>                                  Set the minimum y value
     --ymax <ymax>                                  Set the maximum y value
     --range <xmin> <xmax> <ymin> <ymax>            Set the range of x and y values
+    --formula <name>                               Set the formula: mandelbrot, julia, burning-ship,
+                                                   multibrot3, multibrot4 or multibrot5
+    --julia <real> <imag>                          Render the Julia set of the constant real + imag i
+    --workers <n>                                  Render the image in n worker processes
+    --backend <name>                               Set the backend: auto, cuda, tuned, simd8, simd4,
+                                                   openmp or scalar. auto picks the fastest on this host
+    --recalibrate                                  Measure the backends again for --backend auto
+    --autotune                                     Tune the CPU backends on this host and keep the
+                                                   result in the profile
+    --numa                                         Pin the threads to NUMA nodes and colorize on
+                                                   all threads
+    --huge-pages                                   Allocate the images with transparent huge pages
+    --threads <n|render:warp:write>                Split n threads between the video stages, or
+                                                   set the threads of every stage
     --center <xcenter> <ycenter> <xsize> <ysize>   Set the center and size for video
     --video <max_step> <zoom_factor> <scale_rate>  Generate a zooming animation
-    --with-keyframes                               Generate keyframes for the video
+    --batch <manifest>                             Render every view of a manifest in one process
+    --serve <port>                                 Serve map tiles over HTTP on localhost
+    --buddhabrot <samples>                         Render the orbit density of the given samples
+    --area <samples>                               Estimate the area of the set with the given samples
+    --with-keyframes                               Write the keyframe images of the video
     --auto-detect                                  Automatically detect keyframes
     --show-grid                                    Show grid on keyframes
+    --nucleus                                      Aim --auto-detect at a periodic nucleus (minibrot)
+                                                   near the first target, located by Newton's method
+    --bidirectional                                Blend each keyframe with the next one in between
+    --format <encoded|y4m|raw>                     Set the video format. y4m and raw stream
+                                                   uncompressed frames to a file or a named pipe
+    --yuv                                          Colorize and warp the frames in YUV 4:2:0. y4m
+                                                   writes them as they are
+    --fps <fps>                                    Set the frame rate of the video
+    --keyframe-dir <dir>                           Set the directory of the keyframes
+    --keyframe-format <png|qoi|raw>                Set the format of the keyframes. raw writes the
+                                                   escape counts as PFM
+    --png-compression <level>                      Set the PNG compression level from 0 to 9
+    --checkpoint <dir>                             Keep a journal and the video segments in dir
+    --resume                                       Continue the video recorded in --checkpoint
+    --trace <filename>                             Write a Chrome trace of the video pipeline
+    --perf-counters                                Report hardware counters per pipeline stage
     --help                                         Display this help message
 
 Default values:
@@ -106,6 +176,32 @@ CommandLineArguments parseArguments(int argc, char **argv_raw) {
             .output = "MandelbrotSet.mp4",
             .auto_detect = false,
             .show_grid = false,
+            .nucleus = false,
+            .bidirectional = false,
+            .video_format = Mandelbrot::VideoFormat::Encoded,
+            .yuv = false,
+            .fps = 30.0,
+            .keyframe_dir = "frames",
+            .keyframe_format = Mandelbrot::ImageFormat::PNG,
+            .png_compression = -1,
+            .trace = "",
+            .perf_counters = false,
+            .batch = "",
+            .workers = 0,
+            .serve_port = 0,
+            .formula = Mandelbrot::FormulaKind::Mandelbrot,
+            .julia_real = -0.8,
+            .julia_imag = 0.156,
+            .buddhabrot_samples = 0,
+            .area_samples = 0,
+            .backend = "auto",
+            .recalibrate = false,
+            .autotune = false,
+            .numa = false,
+            .huge_pages = false,
+            .threads = nullopt,
+            .checkpoint = "",
+            .resume = false,
     };
     vector<string> argv(argv_raw, argv_raw + argc);
     for (size_t i = 1; i < argc; i++) {
@@ -171,6 +267,104 @@ CommandLineArguments parseArguments(int argc, char **argv_raw) {
                 args.auto_detect = true;
             } else if (argv[i] == "--show-grid") {
                 args.show_grid = true;
+            } else if (argv[i] == "--nucleus") {
+                args.nucleus = true;
+            } else if (argv[i] == "--bidirectional") {
+                args.bidirectional = true;
+            } else if (argv[i] == "--format") {
+                MAND_ASSERT(i + 1 < argc);
+                auto format = Mandelbrot::parseVideoFormat(argv[i + 1]);
+                MAND_ASSERT(format.has_value());
+                args.video_format = *format;
+                ++i;
+            } else if (argv[i] == "--yuv") {
+                args.yuv = true;
+            } else if (argv[i] == "--fps") {
+                MAND_ASSERT(i + 1 < argc);
+                args.fps = std::stod(argv[i + 1]);
+                MAND_ASSERT(args.fps > 0);
+                ++i;
+            } else if (argv[i] == "--keyframe-dir") {
+                MAND_ASSERT(i + 1 < argc);
+                args.keyframe_dir = argv[i + 1];
+                ++i;
+            } else if (argv[i] == "--keyframe-format") {
+                MAND_ASSERT(i + 1 < argc);
+                auto format = Mandelbrot::parseImageFormat(argv[i + 1]);
+                MAND_ASSERT(format.has_value());
+                args.keyframe_format = *format;
+                ++i;
+            } else if (argv[i] == "--png-compression") {
+                MAND_ASSERT(i + 1 < argc);
+                args.png_compression = std::stoi(argv[i + 1]);
+                MAND_ASSERT(0 <= args.png_compression && args.png_compression <= 9);
+                ++i;
+            } else if (argv[i] == "--checkpoint") {
+                MAND_ASSERT(i + 1 < argc);
+                args.checkpoint = argv[i + 1];
+                ++i;
+            } else if (argv[i] == "--resume") {
+                args.resume = true;
+            } else if (argv[i] == "--trace") {
+                MAND_ASSERT(i + 1 < argc);
+                args.trace = argv[i + 1];
+                ++i;
+            } else if (argv[i] == "--perf-counters") {
+                args.perf_counters = true;
+            } else if (argv[i] == "--workers") {
+                MAND_ASSERT(i + 1 < argc);
+                args.workers = std::stoi(argv[i + 1]);
+                MAND_ASSERT(args.workers > 0);
+                ++i;
+            } else if (argv[i] == "--formula") {
+                MAND_ASSERT(i + 1 < argc);
+                const auto formula = Mandelbrot::parseFormulaKind(argv[i + 1]);
+                MAND_ASSERT(formula.has_value());
+                args.formula = *formula;
+                ++i;
+            } else if (argv[i] == "--julia") {
+                MAND_ASSERT(i + 2 < argc);
+                args.formula = Mandelbrot::FormulaKind::Julia;
+                args.julia_real = std::stod(argv[i + 1]);
+                args.julia_imag = std::stod(argv[i + 2]);
+                i += 2;
+            } else if (argv[i] == "--buddhabrot") {
+                MAND_ASSERT(i + 1 < argc);
+                args.buddhabrot_samples = std::stoull(argv[i + 1]);
+                MAND_ASSERT(args.buddhabrot_samples > 0);
+                ++i;
+            } else if (argv[i] == "--area") {
+                MAND_ASSERT(i + 1 < argc);
+                args.area_samples = std::stoull(argv[i + 1]);
+                MAND_ASSERT(args.area_samples > 0);
+                ++i;
+            } else if (argv[i] == "--backend") {
+                MAND_ASSERT(i + 1 < argc);
+                args.backend = argv[i + 1];
+                MAND_ASSERT(args.backend == "auto" || Mandelbrot::findBackend(args.backend));
+                ++i;
+            } else if (argv[i] == "--recalibrate") {
+                args.recalibrate = true;
+            } else if (argv[i] == "--autotune") {
+                args.autotune = true;
+            } else if (argv[i] == "--numa") {
+                args.numa = true;
+            } else if (argv[i] == "--huge-pages") {
+                args.huge_pages = true;
+            } else if (argv[i] == "--threads") {
+                MAND_ASSERT(i + 1 < argc);
+                args.threads = Mandelbrot::ThreadBudget::parse(argv[i + 1]);
+                MAND_ASSERT(args.threads.has_value());
+                ++i;
+            } else if (argv[i] == "--serve") {
+                MAND_ASSERT(i + 1 < argc);
+                args.serve_port = std::stoi(argv[i + 1]);
+                MAND_ASSERT(0 < args.serve_port && args.serve_port < 65536);
+                ++i;
+            } else if (argv[i] == "--batch") {
+                MAND_ASSERT(i + 1 < argc);
+                args.batch = argv[i + 1];
+                ++i;
             } else if (argv[i] == "--help") {
                 cout << HELP_MSG;
                 exit(0);
@@ -181,6 +375,8 @@ CommandLineArguments parseArguments(int argc, char **argv_raw) {
             goto error;
         }
     }
+    MAND_ASSERT(!args.resume || !args.checkpoint.empty());
+    MAND_ASSERT(!args.nucleus || args.auto_detect);
     return args;
 
 error:
@@ -189,8 +385,50 @@ error:
     terminate();
 }
 
-void generateImage(const CommandLineArguments &args) {
-    DefaultMandelbrotSet mandelbrot_set;
+/**
+ * @brief Render an image on a CPU engine as a stream of tiles, and colorize every tile as soon as it is rendered.
+ * @return The raw matrix and the image. Both are the same as those of generateRawMatrix() and colorize(), bit for bit,
+ *         since the tiles are rendered on the pixel grid of the whole image.
+ * @note An error of a tile is rethrown here, once the other tiles are done.
+ */
+template<typename MandelbrotSetImpl>
+std::pair<cv::Mat, cv::Mat> streamImage(const MandelbrotSetImpl &mandelbrot_set) {
+    const auto width = static_cast<int>(mandelbrot_set.getWidth());
+    const auto height = static_cast<int>(mandelbrot_set.getHeight());
+    cv::Mat raw(height, width, CV_32FC1), image(height, width, CV_8UC3);
+
+    // The tiles render one per thread, so the threads of the engine become the workers of the pool.
+    const auto thread_count = mandelbrot_set.getThreadCount();
+    const auto workers = thread_count > 0 ? static_cast<unsigned int>(thread_count)
+                                          : std::max(1u, std::thread::hardware_concurrency());
+    exec::static_thread_pool pool(workers);
+    if (Mandelbrot::Numa::pinning()) {
+        // This thread is pinned to the first node, and the workers would inherit that.
+        Mandelbrot::onEveryThread(pool.get_scheduler(), workers, [workers](size_t i) {
+            Mandelbrot::Numa::pinCurrentThread(Mandelbrot::Numa::threadCpus(i, workers));
+        });
+    }
+    auto stream = mandelbrot_set.tiles();
+    exec::async_scope scope;
+    scope.spawn(stream.render(pool.get_scheduler()));
+    try {
+        // This thread colorizes the finished tiles while the pool renders the rest.
+        while (auto tile = std::get<0>(*ex::sync_wait(stream.next()))) {
+            cv::Mat raw_target = raw(tile->rect), image_target = image(tile->rect);
+            tile->raw.copyTo(raw_target);
+            Mandelbrot::Perf::Scope perf_scope("colorize");
+            stream.colorize(*tile).copyTo(image_target);
+        }
+    } catch (...) {
+        ex::sync_wait(scope.on_empty());
+        throw;
+    }
+    ex::sync_wait(scope.on_empty());
+    return {raw, image};
+}
+
+template<typename MandelbrotSetImpl>
+bool generateImage(const CommandLineArguments &args, MandelbrotSetImpl &mandelbrot_set) {
     mandelbrot_set.setResolution(args.width, args.height)
             .setXRange(args.x_min, args.x_max)
             .setYRange(args.y_min, args.y_max)
@@ -202,16 +440,178 @@ void generateImage(const CommandLineArguments &args) {
     cout << "YRange: " << mandelbrot_set.getYMin() << " - " << mandelbrot_set.getYMax() << endl;
 
     std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
-    const auto image_cuda = mandelbrot_set.generate();
+    cv::Mat raw, image_cuda;
+    Mandelbrot::RenderStats stats;
+    if (args.workers > 0) {
+        const auto coordinator = Mandelbrot::TileCoordinator().setWorkerCount(args.workers);
+        try {
+            if constexpr (requires { mandelbrot_set.setThreadCount(1); }) {
+                raw = coordinator.render(mandelbrot_set);
+            } else {
+                // The workers always render on the CPU.
+                Mandelbrot::MandelbrotSet cpu_set;
+                cpu_set.setResolution(args.width, args.height)
+                        .setXRange(args.x_min, args.x_max)
+                        .setYRange(args.y_min, args.y_max);
+                raw = coordinator.render(cpu_set);
+            }
+        } catch (const std::runtime_error &e) {
+            cout << e.what() << endl;
+            return false;
+        }
+        stats = Mandelbrot::RenderStats::fromRawMatrix(raw, Mandelbrot::MAX_ITERATIONS);
+    } else if constexpr (requires { mandelbrot_set.getThreadCount(); }) {
+        // The CPU engines stream their tiles, so the colors of the finished tiles overlap the render of the rest.
+        const auto cpu_start = std::clock();
+        try {
+            std::tie(raw, image_cuda) = streamImage(mandelbrot_set);
+        } catch (const std::exception &e) {
+            cout << e.what() << endl;
+            return false;
+        }
+        stats = Mandelbrot::RenderStats::fromRawMatrix(raw, Mandelbrot::MAX_ITERATIONS);
+        stats.cpu_time = static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+    } else {
+        raw = mandelbrot_set.generateRawMatrix(stats);
+    }
+    if (image_cuda.empty()) {
+        Mandelbrot::Perf::Scope perf_scope("colorize");
+        image_cuda = mandelbrot_set.colorize(raw);
+    }
     std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
     auto diff = std::chrono::duration_cast<std::chrono::duration<double>>(end - start);
     cout << "Time taken to generate the image: " << diff.count() << " seconds" << endl;
 
+    cout << "Iterations: " << stats.total_iterations << " (" << stats.meanIterations() << " per pixel)" << endl;
+    cout << "Interior: " << stats.interior << ", escaped: " << stats.escaped << endl;
+    if (args.workers == 0) {
+        cout << "Render CPU time: " << stats.cpu_time << " seconds" << endl;
+    }
+
     auto filename = args.set_output ? args.output : "MandelbrotSet.png";
     imwrite(filename, image_cuda);
+    return true;
+}
+
+template<typename Formula>
+bool generateFormulaImage(const CommandLineArguments &args, const Formula &formula) {
+    using namespace Mandelbrot;
+    // The backends other than the CPU engines are Mandelbrot only, so the other formulas take the CPU engine named by
+    // --backend and the 8-lane one otherwise.
+    if (args.backend == "openmp" || args.backend == "scalar") {
+        BasicMandelbrotSet<Formula> mandelbrot_set;
+        mandelbrot_set.setFormula(formula);
+        if (args.backend == "scalar") {
+            mandelbrot_set.setThreadCount(1);
+        }
+        return generateImage(args, mandelbrot_set);
+    }
+    if (args.backend == "simd4") {
+        BasicMandelbrotSetSimd<Formula, 4> mandelbrot_set;
+        mandelbrot_set.setFormula(formula);
+        return generateImage(args, mandelbrot_set);
+    }
+    BasicMandelbrotSetSimd<Formula, 8> mandelbrot_set;
+    mandelbrot_set.setFormula(formula);
+    return generateImage(args, mandelbrot_set);
+}
+
+bool generateImage(const CommandLineArguments &args) {
+    using namespace Mandelbrot;
+    switch (args.formula) {
+        case FormulaKind::Julia:
+            return generateFormulaImage(args, JuliaFormula{args.julia_real, args.julia_imag});
+        case FormulaKind::BurningShip:
+            return generateFormulaImage(args, BurningShipFormula{});
+        case FormulaKind::Multibrot3:
+            return generateFormulaImage(args, MultibrotFormula<3>{});
+        case FormulaKind::Multibrot4:
+            return generateFormulaImage(args, MultibrotFormula<4>{});
+        case FormulaKind::Multibrot5:
+            return generateFormulaImage(args, MultibrotFormula<5>{});
+        case FormulaKind::Mandelbrot:
+        default: {
+            DefaultMandelbrotSet mandelbrot_set;
+            return generateImage(args, mandelbrot_set);
+        }
+    }
 }
 
-void asyncGenerateVideo(const CommandLineArguments &args) {
+bool generateBuddhabrot(const CommandLineArguments &args) {
+    Mandelbrot::Buddhabrot buddhabrot(args.width, args.height);
+    buddhabrot.setXRange(args.x_min, args.x_max)
+            .setYRange(args.y_min, args.y_max)
+            .setSampleCount(args.buddhabrot_samples);
+
+    const auto density = buddhabrot.generateDensity();
+    const auto image = [&] {
+        Mandelbrot::Perf::Scope perf_scope("toneMap");
+        return buddhabrot.toneMap(density);
+    }();
+    const auto &stats = buddhabrot.getStats();
+    cout << fixed << setprecision(2);
+    cout << "Time taken to sample the orbits: " << stats.wall_time << " seconds" << endl;
+    cout << "Samples: " << stats.samples << ", orbits: " << stats.orbits << ", orbit points: " << stats.points << endl;
+
+    auto filename = args.set_output ? args.output : "Buddhabrot.png";
+    imwrite(filename, image);
+    return true;
+}
+
+bool estimateArea(const CommandLineArguments &args) {
+    using Mandelbrot::println;
+    Mandelbrot::AreaEstimator estimator;
+    estimator.setSampleCount(args.area_samples);
+    const auto estimate = estimator.estimate();
+    const auto &stats = estimator.getStats();
+
+    println(stdout, "{:>5} {:>12} {:>9} {:>12} {:>14} {:>11}", "Round", "Samples", "Seconds", "Samples/s", "Area",
+            "95% CI");
+    for (size_t i = 0; i < stats.rounds.size(); ++i) {
+        const auto &round = stats.rounds[i];
+        println(stdout, "{:>5} {:>12} {:>9.2f} {:>12.0f} {:>14.8f} {:>11.8f}", i, round.samples, round.elapsed,
+                round.samples / round.elapsed, round.area, round.half_width);
+    }
+    println(stdout, "Area: {:.8f} +- {:.8f} (95%), undecided samples may add up to {:.8f}", estimate.area,
+            estimate.half_width, estimate.undecided_area);
+    println(stdout, "Samples: {}, inside: {}, undecided: {}, iterations: {}", stats.samples, stats.interior,
+            stats.undecided, stats.iterations);
+    println(stdout, "Reference: {:.8f}, {:+.2f} half widths away", Mandelbrot::AreaEstimator::REFERENCE_AREA,
+            (Mandelbrot::AreaEstimator::REFERENCE_AREA - estimate.area) / estimate.half_width);
+    return true;
+}
+
+bool generateBatch(const CommandLineArguments &args) {
+    std::ifstream manifest(args.batch);
+    if (!manifest) {
+        cout << "Cannot open the batch manifest " << args.batch << endl;
+        return false;
+    }
+    vector<Mandelbrot::BatchJob> jobs;
+    try {
+        jobs = Mandelbrot::parseBatchManifest(manifest);
+    } catch (const std::runtime_error &e) {
+        cout << e.what() << endl;
+        return false;
+    }
+
+    Mandelbrot::BatchRenderer renderer;
+    return renderer.run(jobs) == 0;
+}
+
+bool serveTiles(const CommandLineArguments &args) {
+    Mandelbrot::TileServer server;
+    server.setColors(Mandelbrot::colorScheme2());
+    // The server only returns if it cannot listen.
+    try {
+        server.run(args.serve_port);
+    } catch (const std::runtime_error &e) {
+        cout << e.what() << endl;
+    }
+    return false;
+}
+
+bool asyncGenerateVideo(const CommandLineArguments &args) {
     // Require arguments: max_step, zoom_factor, scale_rate, x_center, y_center, xsize, width, height
     // Some constants for the zooming animation. We may make them configurable later.
     const int max_step = args.max_step;
@@ -234,12 +634,33 @@ void asyncGenerateVideo(const CommandLineArguments &args) {
             .setMaxStep(max_step)
             .setZoomFactor(zoom_factor)
             .setScaleRate(scale_rate)
-            .setColors(Mandelbrot::randomScheme())
+            .setColorSeed(std::random_device{}())
             .setAutoDetect(args.auto_detect)
             .setShowGrid(args.show_grid)
-            .setVideoName(args.output);
+            .setNucleus(args.nucleus)
+            .setInterpolationMode(args.bidirectional ? Mandelbrot::InterpolationMode::Bidirectional
+                                                     : Mandelbrot::InterpolationMode::Forward)
+            .setVideoName(args.output)
+            .setVideoFormat(args.video_format)
+            .setYuv(args.yuv)
+            .setFps(args.fps)
+            .setWriteKeyframes(args.with_key_frames)
+            .setKeyframeDirectory(args.keyframe_dir)
+            .setKeyframeFormat(args.keyframe_format)
+            .setPngCompression(args.png_compression)
+            .setCheckpointDirectory(args.checkpoint)
+            .setResume(args.resume);
+    if (args.threads) {
+        generator.setThreadBudget(*args.threads);
+    }
 
-    generator.start();
+    try {
+        generator.start();
+    } catch (const std::runtime_error &e) {
+        cout << e.what() << endl;
+        return false;
+    }
+    return true;
 }
 
 int main(int argc, char **argv) {
@@ -247,16 +668,80 @@ int main(int argc, char **argv) {
 
     CommandLineArguments args = parseArguments(argc, argv);
 
+    if (!args.trace.empty()) {
+        if (Mandelbrot::Trace::AVAILABLE) {
+            Mandelbrot::Trace::setOutput(args.trace);
+        } else {
+            cout << "Tracing is not available in this build. Rebuild with -DENABLE_TRACING=ON." << endl;
+        }
+    }
+
+    if (args.perf_counters && !Mandelbrot::Perf::enable()) {
+        cout << "Hardware counters are not available. Only the timing will be reported." << endl;
+    }
+
+    if (args.numa || args.huge_pages) {
+        if (Mandelbrot::Numa::enable(args.numa, args.huge_pages)) {
+            Mandelbrot::Numa::pinOpenMPThreads();
+        } else {
+            cout << "NUMA pinning and huge pages are only available on Linux." << endl;
+        }
+    }
+
     std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
 
-    cout << "Current implementation: " << CURRENT_IMPLEMENTATION << endl;
+    // Batch mode, the tile server, the Buddhabrot and the other formulas render on a CPU engine directly.
+    const bool uses_backend = args.serve_port == 0 && args.batch.empty() && args.buddhabrot_samples == 0 &&
+                              args.area_samples == 0 &&
+                              (args.video || args.formula == Mandelbrot::FormulaKind::Mandelbrot);
+    if (uses_backend) {
+        // The tunings come first, since the tuned backend is only available with them.
+        Mandelbrot::Profile profile;
+        if (args.autotune) {
+            Mandelbrot::autotune(profile);
+        }
+        Mandelbrot::loadTunings(profile);
+
+        const Mandelbrot::Backend *backend = nullptr;
+        if (args.backend == "auto") {
+            backend = &Mandelbrot::selectBackend(profile, args.recalibrate);
+        } else {
+            backend = Mandelbrot::findBackend(args.backend);
+            if (!backend->available()) {
+                cout << "The backend " << args.backend << " is not available on this host" << endl;
+                return 1;
+            }
+        }
+        Mandelbrot::RuntimeMandelbrotSet::setDefaultBackend(*backend);
+        cout << "Current implementation: " << backend->description << endl;
+    }
     cout << "CPU cores: " << std::thread::hardware_concurrency() << endl;
 
+    if (args.formula != Mandelbrot::FormulaKind::Mandelbrot && (args.video || !args.batch.empty() || args.serve_port ||
+                                                             args.buddhabrot_samples || args.area_samples)) {
+        cout << "--formula only applies to still images. Using the Mandelbrot set." << endl;
+    }
+    if (args.autotune && !uses_backend) {
+        cout << "--autotune only applies to the backends of images and videos." << endl;
+    }
+    if (args.threads && !args.video) {
+        cout << "--threads only applies to videos." << endl;
+    }
+
+    bool success = true;
 #if 1
-    if (args.video) {
-        asyncGenerateVideo(args);
+    if (args.serve_port > 0) {
+        success = serveTiles(args);
+    } else if (!args.batch.empty()) {
+        success = generateBatch(args);
+    } else if (args.buddhabrot_samples > 0) {
+        success = generateBuddhabrot(args);
+    } else if (args.area_samples > 0) {
+        success = estimateArea(args);
+    } else if (args.video) {
+        success = asyncGenerateVideo(args);
     } else {
-        generateImage(args);
+        success = generateImage(args);
     }
 #else
 
@@ -323,6 +808,9 @@ int main(int argc, char **argv) {
 #endif
 
     cout << "Total time: " << TIME_DIFF(begin) << " seconds" << endl;
+    if (args.perf_counters) {
+        Mandelbrot::Perf::report(stdout);
+    }
 
-    return 0;
+    return success ? 0 : 1;
 }